@@ -0,0 +1,117 @@
+// Compares the EXIFInfo parser against the zero allocation EXIFRecord parser
+// on a set of JPEG files, which are read into memory first so that only the
+// parsing is timed.
+//
+// Usage: bench <iterations> <JPEG files...>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+#include "exif.h"
+
+static unsigned long long g_allocations = 0;
+
+void *operator new(std::size_t size) {
+  ++g_allocations;
+  void *p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, std::size_t) noexcept { free(p); }
+
+struct File {
+  std::string path;
+  std::vector<unsigned char> data;
+};
+
+template <typename Fn>
+void run(const char *name, const std::vector<File> &files, int iterations,
+         Fn parse) {
+  const unsigned long long allocations = g_allocations;
+  unsigned long long parsed = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    for (const File &file : files) {
+      if (parse(file.data.data(), static_cast<unsigned>(file.data.size())) ==
+          PARSE_EXIF_SUCCESS)
+        ++parsed;
+    }
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  const double count = static_cast<double>(files.size()) * iterations;
+  printf("%-28s %9.0f ns/file %8.1f allocations/file (%llu parsed)\n", name,
+         seconds * 1e9 / count,
+         static_cast<double>(g_allocations - allocations) / count, parsed);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    printf("Usage: bench <iterations> <JPEG files...>\n");
+    return -1;
+  }
+
+  const int iterations = atoi(argv[1]);
+  std::vector<File> files;
+  for (int i = 2; i < argc; ++i) {
+    FILE *fp = fopen(argv[i], "rb");
+    if (!fp) continue;
+    fseek(fp, 0, SEEK_END);
+    File file;
+    file.path = argv[i];
+    file.data.resize(ftell(fp));
+    rewind(fp);
+    if (fread(file.data.data(), 1, file.data.size(), fp) == file.data.size())
+      files.push_back(std::move(file));
+    fclose(fp);
+  }
+  if (files.empty() || iterations < 1) return -1;
+
+  // both parsers have to agree on the common fields
+  for (const File &file : files) {
+    tinyexif::EXIFInfo info;
+    tinyexif::EXIFRecord record;
+    const unsigned len = static_cast<unsigned>(file.data.size());
+    const int info_code = info.parseFromHeader(file.data.data(), len);
+    const int record_code =
+        tinyexif::parseFromHeader(file.data.data(), len, record);
+    if (info_code != record_code ||
+        (info_code == PARSE_EXIF_SUCCESS &&
+         (info.Make != record.str(record.Make) ||
+          info.Model != record.str(record.Model) ||
+          info.DateTimeOriginal != record.str(record.DateTimeOriginal) ||
+          info.Orientation != record.Orientation ||
+          info.ISOSpeedRatings != record.ISOSpeedRatings ||
+          info.FNumber != record.FNumber ||
+          info.ExposureTime != record.ExposureTime ||
+          info.FocalLength != record.FocalLength ||
+          info.ImageWidth != record.ImageWidth ||
+          info.ThumbnailOffset != record.ThumbnailOffset ||
+          info.ThumbnailLength != record.ThumbnailLength)))
+      printf("MISMATCH %s\n", file.path.c_str());
+  }
+
+  printf("%zu files, %d iterations, EXIFInfo %zu bytes, EXIFRecord %zu bytes\n",
+         files.size(), iterations, sizeof(tinyexif::EXIFInfo),
+         sizeof(tinyexif::EXIFRecord));
+  run("EXIFInfo::parseFrom", files, iterations,
+      [](const unsigned char *buf, unsigned len) {
+        tinyexif::EXIFInfo info;
+        return info.parseFrom(buf, len);
+      });
+  run("EXIFInfo::parseFromHeader", files, iterations,
+      [](const unsigned char *buf, unsigned len) {
+        tinyexif::EXIFInfo info;
+        return info.parseFromHeader(buf, len);
+      });
+  run("parseFromHeader(EXIFRecord)", files, iterations,
+      [](const unsigned char *buf, unsigned len) {
+        tinyexif::EXIFRecord record;
+        return tinyexif::parseFromHeader(buf, len, record);
+      });
+  return 0;
+}
@@ -479,6 +479,116 @@ IFEntry parseIFEntry(const unsigned char *buf, const unsigned offs,
     return parseIFEntry_temp<false>(buf, offs, base, len);
   }
 }
+
+// Walks the JPEG markers from SOI, jumping over each segment by its length,
+// up to the start of the scan. Every segment starts with 0xFF and a marker
+// byte, optionally preceded by 0xFF fill bytes, followed by the segment length
+// (Motorola byte order) which includes the length bytes themselves.
+//
+// PARAM 'segment_offs', 'segment_len': location of the EXIF segment, starting
+//                                      at the bytes "Exif\0\0"
+// PARAM 'frame_width', 'frame_height': from the frame header (SOFn), 0 if it
+//                                      was not reached
+// RETURN: PARSE_EXIF_SUCCESS if the EXIF segment was found
+int findEXIFSegment(const unsigned char *buf, unsigned len,
+                    unsigned &segment_offs, unsigned &segment_len,
+                    unsigned &frame_width, unsigned &frame_height) {
+  segment_offs = segment_len = frame_width = frame_height = 0;
+
+  // Sanity check: all JPEG files start with 0xFFD8.
+  if (!buf || len < 4) return PARSE_EXIF_ERROR_NO_JPEG;
+  if (buf[0] != 0xFF || buf[1] != 0xD8) return PARSE_EXIF_ERROR_NO_JPEG;
+
+  unsigned offs = 2;  // current offset into buffer
+  while (offs + 4 <= len) {
+    if (buf[offs] != 0xFF) return PARSE_EXIF_ERROR_CORRUPT;
+    const unsigned char marker = buf[offs + 1];
+    if (marker == 0xFF) {
+      offs++;
+      continue;
+    }
+    if (marker == 0xDA || marker == 0xD9)
+      return segment_len ? PARSE_EXIF_SUCCESS : PARSE_EXIF_ERROR_NO_EXIF;
+
+    const unsigned section_length = parse_value<uint16_t>(buf + offs + 2, false);
+    if (section_length < 2) return PARSE_EXIF_ERROR_CORRUPT;
+
+    if (marker == 0xE1 && !segment_len && section_length >= 16) {
+      // APP1 holds either the EXIF data or XMP, only the former starts with
+      // the bytes "Exif\0\0"
+      if (offs + 2 + section_length > len) break;
+      if (std::equal(buf + offs + 4, buf + offs + 10, "Exif\0\0")) {
+        segment_offs = offs + 4;
+        segment_len = section_length - 2;
+      }
+    } else if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 &&
+               marker != 0xC8 && marker != 0xCC) {
+      // SOFn: 1 byte precision, 2 bytes height, 2 bytes width, ...
+      if (offs + 9 > len) break;
+      frame_height = parse_value<uint16_t>(buf + offs + 5, false);
+      frame_width = parse_value<uint16_t>(buf + offs + 7, false);
+    }
+
+    offs += 2 + section_length;
+  }
+
+  // ran out of buffer before the start of the scan
+  return segment_len ? PARSE_EXIF_SUCCESS : PARSE_EXIF_ERROR_TRUNCATED;
+}
+
+// Parses IFD1, which describes the thumbnail. Only JPEG thumbnails
+// (compression 6) are of interest, they are stored as a complete JPEG at the
+// JPEGInterchangeFormat offset.
+//
+// PARAM 'thumbnail_offset': offset from the start of 'buf'
+// PARAM 'thumbnail_length': left untouched if there is no JPEG thumbnail
+void findThumbnail(const unsigned char *buf, unsigned len,
+                   unsigned tiff_header_start, unsigned ifd1_offset,
+                   bool alignIntel, unsigned &thumbnail_offset,
+                   unsigned &thumbnail_length) {
+  if (!ifd1_offset || tiff_header_start + ifd1_offset + 2 > len) return;
+
+  unsigned offs = tiff_header_start + ifd1_offset;
+  int num_entries = parse_value<uint16_t>(buf + offs, alignIntel);
+  if (offs + 6 + 12 * num_entries > len) return;
+  offs += 2;
+
+  unsigned short compression = 6;
+  unsigned jpeg_offset = 0;
+  unsigned jpeg_length = 0;
+  while (--num_entries >= 0) {
+    unsigned short tag, format;
+    unsigned length, data;
+    parseIFEntryHeader(buf + offs, alignIntel, tag, format, length, data);
+    switch (tag) {
+      case 0x103:
+        // Compression (short values are stored in the upper bytes of
+        // the data field in Motorola byte order)
+        if (format == 3)
+          compression = static_cast<unsigned short>(
+              alignIntel ? (data & 0xFFFF) : (data >> 16));
+        break;
+
+      case 0x201:
+        // JPEGInterchangeFormat (offset of the thumbnail)
+        if (format == 4) jpeg_offset = data;
+        break;
+
+      case 0x202:
+        // JPEGInterchangeFormatLength (length of the thumbnail)
+        if (format == 4) jpeg_length = data;
+        break;
+    }
+    offs += 12;
+  }
+
+  if (compression == 6 && jpeg_offset && jpeg_length &&
+      tiff_header_start + jpeg_offset < len &&
+      jpeg_length <= len - tiff_header_start - jpeg_offset) {
+    thumbnail_offset = tiff_header_start + jpeg_offset;
+    thumbnail_length = jpeg_length;
+  }
+}
 }  // namespace
 
 //
@@ -531,7 +641,41 @@ int tinyexif::EXIFInfo::parseFrom(const unsigned char *buf, unsigned len) {
   offs += 2;
   VERBOSE(std::cout << "section_length= " << section_length << "\n")
 
-  return parseFromEXIFSegment(buf + offs, len - offs);
+  const int ret = parseFromEXIFSegment(buf + offs, len - offs);
+  // make the thumbnail offset relative to the start of the JPEG
+  if (ret == PARSE_EXIF_SUCCESS && this->ThumbnailLength) {
+    this->ThumbnailOffset += offs;
+  }
+  return ret;
+}
+
+//
+// Walks the JPEG markers from the start of the buffer, jumping over each
+// segment by its length, and parses the EXIF segment (APP1). The frame header
+// (SOFn) gives the image dimensions. Stops at the start of the scan (SOS), so
+// the entropy-coded data is never touched and a buffer holding the first few
+// KB of the file is enough.
+//
+int tinyexif::EXIFInfo::parseFromHeader(const unsigned char *buf,
+                                        unsigned len) {
+  clear();
+
+  unsigned segment_offs, segment_len, frame_width, frame_height;
+  int ret = findEXIFSegment(buf, len, segment_offs, segment_len, frame_width,
+                            frame_height);
+  if (ret != PARSE_EXIF_SUCCESS) return ret;
+
+  ret = parseFromEXIFSegment(buf + segment_offs, segment_len);
+  if (ret != PARSE_EXIF_SUCCESS) return ret;
+  // make the thumbnail offset relative to the start of the JPEG
+  if (this->ThumbnailLength) this->ThumbnailOffset += segment_offs;
+
+  // not every camera writes PixelXDimension/PixelYDimension
+  if (!this->ImageWidth || !this->ImageHeight) {
+    this->ImageWidth = frame_width;
+    this->ImageHeight = frame_height;
+  }
+  return PARSE_EXIF_SUCCESS;
 }
 
 int tinyexif::EXIFInfo::parseFrom(const string &data) {
@@ -547,12 +691,30 @@ int tinyexif::EXIFInfo::parseFrom(const string &data) {
 //
 int tinyexif::EXIFInfo::parseFromEXIFSegment(const unsigned char *buf,
                                              unsigned len) {
-  bool alignIntel = true;  // byte alignment (defined in EXIF header)
-  unsigned offs = 0;       // current offset into buffer
   if (!buf || len < 6) return PARSE_EXIF_ERROR_NO_EXIF;
 
   if (!std::equal(buf, buf + 6, "Exif\0\0")) return PARSE_EXIF_ERROR_NO_EXIF;
-  offs += 6;
+
+  const int ret = parseFromTIFF(buf + 6, len - 6);
+  // make the thumbnail offset relative to the start of the segment
+  if (ret == PARSE_EXIF_SUCCESS && this->ThumbnailLength) {
+    this->ThumbnailOffset += 6;
+  }
+  return ret;
+}
+
+//
+// Parses the IFDs of a TIFF structure, either the payload of an EXIF
+// segment or the start of a TIFF based raw file.
+//
+// PARAM: 'buf' start of the TIFF header ("II" or "MM").
+// PARAM: 'len' length of buffer
+//
+int tinyexif::EXIFInfo::parseFromTIFF(const unsigned char *buf,
+                                      unsigned len) {
+  bool alignIntel = true;  // byte alignment (defined in EXIF header)
+  unsigned offs = 0;       // current offset into buffer
+  if (!buf) return PARSE_EXIF_ERROR_NO_EXIF;
 
   // Now parsing the TIFF header. The first two bytes are either "II" or
   // "MM" for Intel or Motorola byte alignment. Sanity check by parsing
@@ -678,6 +840,12 @@ int tinyexif::EXIFInfo::parseFromEXIFSegment(const unsigned char *buf,
     }
   }
 
+  // The last 4 bytes of IFD0 are the offset to IFD1, which describes the
+  // thumbnail.
+  findThumbnail(buf, len, tiff_header_start,
+                parse_value<uint32_t>(buf + offs, alignIntel), alignIntel,
+                this->ThumbnailOffset, this->ThumbnailLength);
+
   // Jump to the EXIF SubIFD if it exists and parse all the information
   // there. Note that it's possible that the EXIF SubIFD doesn't exist.
   // The EXIF SubIFD contains most of the interesting information that a
@@ -1034,4 +1202,522 @@ void tinyexif::EXIFInfo::clear() {
   LensInfo.FocalPlaneXResolution = 0;
   LensInfo.Make = "";
   LensInfo.Model = "";
+
+  // Thumbnail
+  ThumbnailOffset = 0;
+  ThumbnailLength = 0;
+}
+
+namespace {
+
+// Magic number that follows the byte order of a TIFF header: 0x2a for TIFF
+// (and the raw formats based on it, e.g. NEF, CR2, ARW, DNG), 0x4f52 and
+// 0x5352 for ORF, 0x55 for RW2. Shared by the EXIF and the preview parsers
+// so that they accept the same files.
+bool isTIFFMagic(uint16_t magic) {
+  return magic == 0x2a || magic == 0x4f52 || magic == 0x5352 || magic == 0x55;
+}
+
+// IFD entry that is read in place, the values are parsed straight from the
+// buffer instead of being copied into vectors like IFEntry does
+struct EntryView {
+  const unsigned char *buf;
+  unsigned len;
+  unsigned base;  // start of the TIFF header
+  unsigned offs;  // offset of the entry
+  bool alignIntel;
+  unsigned short tag;
+  unsigned short format;
+  unsigned length;
+  unsigned data;
+
+  EntryView(const unsigned char *buffer, unsigned buffer_len,
+            unsigned tiff_base, unsigned entry_offs, bool intel)
+      : buf(buffer),
+        len(buffer_len),
+        base(tiff_base),
+        offs(entry_offs),
+        alignIntel(intel) {
+    parseIFEntryHeader(buf + offs, alignIntel, tag, format, length, data);
+  }
+
+  // Values that fit into 4 bytes are stored in the data field itself.
+  // RETURN: the first value, nullptr if the values are out of bounds
+  const unsigned char *values(unsigned size) const {
+    const unsigned long long total =
+        static_cast<unsigned long long>(size) * length;
+    if (total <= 4) return buf + offs + 8;
+    if (base + static_cast<unsigned long long>(data) + total > len)
+      return nullptr;
+    return buf + base + data;
+  }
+
+  bool getShort(unsigned short &value) const {
+    const unsigned char *p = format == 3 && length ? values(2) : nullptr;
+    if (!p) return false;
+    value = parse_value<uint16_t>(p, alignIntel);
+    return true;
+  }
+
+  // SHORT or LONG
+  bool getUnsigned(unsigned &value) const {
+    unsigned short short_value;
+    if (getShort(short_value)) {
+      value = short_value;
+      return true;
+    }
+    if (format != 4 || length != 1) return false;
+    value = data;
+    return true;
+  }
+
+  // RATIONAL or SRATIONAL
+  bool getRational(unsigned index, double &value) const {
+    if ((format != 5 && format != 10) || index >= length) return false;
+    const unsigned char *p = values(8);
+    if (!p) return false;
+    if (format == 5)
+      value = parse_value<Rational>(p + 8 * index, alignIntel);
+    else
+      value = parse_value<SRational>(p + 8 * index, alignIntel);
+    return true;
+  }
+
+  // Copies an ASCII value into the arena of the record
+  void getString(tinyexif::EXIFRecord &record,
+                 tinyexif::EXIFStringRef &ref) const {
+    const unsigned char *p = format == 2 ? values(1) : nullptr;
+    if (!p) return;
+    unsigned str_length = length;
+    // cut zero bytes at the end
+    while (str_length && p[str_length - 1] == '\0') str_length--;
+    const unsigned available = sizeof(record.Arena) - record.ArenaUsed;
+    if (str_length > available) str_length = available;
+
+    std::copy(p, p + str_length, record.Arena + record.ArenaUsed);
+    ref.Offset = record.ArenaUsed;
+    ref.Length = static_cast<unsigned short>(str_length);
+    record.ArenaUsed = static_cast<unsigned short>(record.ArenaUsed + str_length);
+  }
+};
+
+}  // namespace
+
+int tinyexif::parseFromHeader(const unsigned char *buf, unsigned len,
+                              EXIFRecord &record) {
+  record = EXIFRecord();
+
+  unsigned segment_offs, segment_len, frame_width, frame_height;
+  int ret = findEXIFSegment(buf, len, segment_offs, segment_len, frame_width,
+                            frame_height);
+  if (ret != PARSE_EXIF_SUCCESS) return ret;
+
+  ret = parseFromEXIFSegment(buf + segment_offs, segment_len, record);
+  if (ret != PARSE_EXIF_SUCCESS) return ret;
+  if (record.ThumbnailLength) record.ThumbnailOffset += segment_offs;
+
+  if (!record.ImageWidth || !record.ImageHeight) {
+    record.ImageWidth = frame_width;
+    record.ImageHeight = frame_height;
+  }
+  return PARSE_EXIF_SUCCESS;
+}
+
+int tinyexif::parseFromEXIFSegment(const unsigned char *buf, unsigned len,
+                                   EXIFRecord &record) {
+  record = EXIFRecord();
+  if (!buf || len < 6) return PARSE_EXIF_ERROR_NO_EXIF;
+  if (!std::equal(buf, buf + 6, "Exif\0\0")) return PARSE_EXIF_ERROR_NO_EXIF;
+
+  const int ret = parseFromTIFF(buf + 6, len - 6, record);
+  if (ret == PARSE_EXIF_SUCCESS && record.ThumbnailLength)
+    record.ThumbnailOffset += 6;
+  return ret;
+}
+
+int tinyexif::parseFromTIFF(const unsigned char *buf, unsigned len,
+                            EXIFRecord &record) {
+  record = EXIFRecord();
+  if (!buf) return PARSE_EXIF_ERROR_NO_EXIF;
+  if (len < 8) return PARSE_EXIF_ERROR_CORRUPT;
+
+  // TIFF header, see EXIFInfo::parseFromTIFF()
+  bool alignIntel = true;
+  if (buf[0] == 'I' && buf[1] == 'I')
+    alignIntel = true;
+  else if (buf[0] == 'M' && buf[1] == 'M')
+    alignIntel = false;
+  else
+    return PARSE_EXIF_ERROR_UNKNOWN_BYTEALIGN;
+  record.ByteAlign = alignIntel;
+  if (!isTIFFMagic(parse_value<uint16_t>(buf + 2, alignIntel)))
+    return PARSE_EXIF_ERROR_CORRUPT;
+
+  // IFD0
+  const unsigned long long ifd0_offset =
+      parse_value<uint32_t>(buf + 4, alignIntel);
+  if (ifd0_offset + 2 > len) return PARSE_EXIF_ERROR_CORRUPT;
+  unsigned offs = static_cast<unsigned>(ifd0_offset);
+  unsigned num_entries = parse_value<uint16_t>(buf + offs, alignIntel);
+  if (offs + 6ull + 12ull * num_entries > len) return PARSE_EXIF_ERROR_CORRUPT;
+  offs += 2;
+
+  unsigned long long exif_sub_ifd_offset = len;
+  for (unsigned i = 0; i < num_entries; ++i, offs += 12) {
+    const EntryView entry(buf, len, 0, offs, alignIntel);
+    switch (entry.tag) {
+      case 0x102:
+        // Bits per sample
+        entry.getShort(record.BitsPerSample);
+        break;
+
+      case 0x10E:
+        // Image description
+        entry.getString(record, record.ImageDescription);
+        break;
+
+      case 0x10F:
+        // Digicam make
+        entry.getString(record, record.Make);
+        break;
+
+      case 0x110:
+        // Digicam model
+        entry.getString(record, record.Model);
+        break;
+
+      case 0x112:
+        // Orientation of image
+        entry.getShort(record.Orientation);
+        break;
+
+      case 0x131:
+        // Software used for image
+        entry.getString(record, record.Software);
+        break;
+
+      case 0x132:
+        // EXIF/TIFF date/time of image modification
+        entry.getString(record, record.DateTime);
+        break;
+
+      case 0x8298:
+        // Copyright information
+        entry.getString(record, record.Copyright);
+        break;
+
+      case 0x8769:
+        // EXIF SubIFD offset
+        exif_sub_ifd_offset = entry.data;
+        break;
+    }
+  }
+
+  findThumbnail(buf, len, 0, parse_value<uint32_t>(buf + offs, alignIntel),
+                alignIntel, record.ThumbnailOffset, record.ThumbnailLength);
+
+  // EXIF SubIFD
+  if (exif_sub_ifd_offset + 4 > len) return PARSE_EXIF_SUCCESS;
+  offs = static_cast<unsigned>(exif_sub_ifd_offset);
+  num_entries = parse_value<uint16_t>(buf + offs, alignIntel);
+  if (offs + 6ull + 12ull * num_entries > len) return PARSE_EXIF_ERROR_CORRUPT;
+  offs += 2;
+
+  for (unsigned i = 0; i < num_entries; ++i, offs += 12) {
+    const EntryView entry(buf, len, 0, offs, alignIntel);
+    switch (entry.tag) {
+      case 0x829a:
+        // Exposure time in seconds
+        entry.getRational(0, record.ExposureTime);
+        break;
+
+      case 0x829d:
+        // FNumber
+        entry.getRational(0, record.FNumber);
+        break;
+
+      case 0x8822:
+        // Exposure Program
+        entry.getShort(record.ExposureProgram);
+        break;
+
+      case 0x8827:
+        // ISO Speed Rating
+        entry.getShort(record.ISOSpeedRatings);
+        break;
+
+      case 0x9003:
+        // Original date and time
+        entry.getString(record, record.DateTimeOriginal);
+        break;
+
+      case 0x9004:
+        // Digitization date and time
+        entry.getString(record, record.DateTimeDigitized);
+        break;
+
+      case 0x9204:
+        // Exposure bias value
+        entry.getRational(0, record.ExposureBiasValue);
+        break;
+
+      case 0x9206:
+        // Subject distance
+        entry.getRational(0, record.SubjectDistance);
+        break;
+
+      case 0x9207:
+        // Metering mode
+        entry.getShort(record.MeteringMode);
+        break;
+
+      case 0x9209: {
+        // Flash used
+        unsigned short flash;
+        if (entry.getShort(flash)) {
+          record.Flash = flash & 1;
+          record.FlashReturnedLight = (flash & 6) >> 1;
+          record.FlashMode = (flash & 24) >> 3;
+        }
+        break;
+      }
+
+      case 0x920a:
+        // Focal length
+        entry.getRational(0, record.FocalLength);
+        break;
+
+      case 0x9291:
+        // Subsecond original time
+        entry.getString(record, record.SubSecTimeOriginal);
+        break;
+
+      case 0xa002:
+        // EXIF Image width
+        entry.getUnsigned(record.ImageWidth);
+        break;
+
+      case 0xa003:
+        // EXIF Image height
+        entry.getUnsigned(record.ImageHeight);
+        break;
+
+      case 0xa405:
+        // Focal length in 35mm film
+        entry.getShort(record.FocalLengthIn35mm);
+        break;
+
+      case 0xa432:
+        // Focal length and FStop.
+        entry.getRational(0, record.LensFocalLengthMin);
+        entry.getRational(1, record.LensFocalLengthMax);
+        entry.getRational(2, record.LensFStopMin);
+        entry.getRational(3, record.LensFStopMax);
+        break;
+
+      case 0xa433:
+        // Lens make.
+        entry.getString(record, record.LensMake);
+        break;
+
+      case 0xa434:
+        // Lens model.
+        entry.getString(record, record.LensModel);
+        break;
+    }
+  }
+
+  return PARSE_EXIF_SUCCESS;
+}
+
+namespace {
+
+// State of the IFD walk of a TIFF based raw file, everything is read through
+// the callback so that only the IFDs and the preview headers are touched.
+struct TIFFWalker {
+  tinyexif::ReadCallback read;
+  void *user;
+  unsigned long long fileSize;
+  bool alignIntel;
+  unsigned numIFDs;  // IFDs visited so far (guards against cycles)
+  bool found;
+  tinyexif::JPEGPreview best;
+
+  bool readAt(unsigned long long offset, unsigned char *dst, unsigned size) {
+    if (offset > fileSize || size > fileSize - offset) return false;
+    return read(user, offset, dst, size);
+  }
+
+  // Short values are stored in the upper bytes of the data field in
+  // Motorola byte order.
+  unsigned shortValue(unsigned data) const {
+    return alignIntel ? (data & 0xFFFF) : (data >> 16);
+  }
+
+  // Walks the JPEG markers up to the frame header. Fills out the dimensions
+  // and returns true for baseline, extended and progressive JPEGs.
+  bool readFrameHeader(tinyexif::JPEGPreview &preview) {
+    unsigned char marker[9];
+    if (!readAt(preview.Offset, marker, 2) || marker[0] != 0xFF ||
+        marker[1] != 0xD8)
+      return false;
+
+    unsigned long long offs = preview.Offset + 2;
+    const unsigned long long end = preview.Offset + preview.Length;
+    for (int i = 0; i < 64 && offs + 4 <= end; ++i) {
+      if (!readAt(offs, marker, 4) || marker[0] != 0xFF) return false;
+      const unsigned char type = marker[1];
+      if (type >= 0xC0 && type <= 0xCF && type != 0xC4 && type != 0xC8 &&
+          type != 0xCC) {
+        // stb_image only decodes SOF0, SOF1 and SOF2
+        if (type > 0xC2 || !readAt(offs, marker, 9)) return false;
+        preview.Height = parse<uint16_t, false>(marker + 5);
+        preview.Width = parse<uint16_t, false>(marker + 7);
+        return preview.Width && preview.Height;
+      }
+      if (type == 0xD9 || type == 0xDA) return false;
+      offs += 2 + parse<uint16_t, false>(marker + 2);
+    }
+    return false;
+  }
+
+  void addCandidate(unsigned long long offset, unsigned length) {
+    tinyexif::JPEGPreview preview{offset, length, 0, 0};
+    if (!length || offset >= fileSize || length > fileSize - offset) return;
+    if (!readFrameHeader(preview)) return;
+
+    const unsigned long long pixels =
+        static_cast<unsigned long long>(preview.Width) * preview.Height;
+    if (!found ||
+        pixels > static_cast<unsigned long long>(best.Width) * best.Height) {
+      best = preview;
+      found = true;
+    }
+  }
+
+  // Parses the IFD at 'offset' and its SubIFDs.
+  // RETURN: offset of the next IFD in the chain (0 if there is none)
+  unsigned walkIFD(unsigned offset, int depth) {
+    if (depth > 4 || ++numIFDs > 64) return 0;
+
+    unsigned char count[2];
+    if (!readAt(offset, count, 2)) return 0;
+    const unsigned num_entries = parse_value<uint16_t>(count, alignIntel);
+    if (num_entries == 0 || num_entries > 1024) return 0;
+
+    // the entries followed by the offset of the next IFD
+    std::vector<unsigned char> ifd(12 * num_entries + 4);
+    const unsigned ifd_size = static_cast<unsigned>(ifd.size());
+    bool has_next = readAt(offset + 2, ifd.data(), ifd_size);
+    if (!has_next && !readAt(offset + 2, ifd.data(), ifd_size - 4)) return 0;
+
+    unsigned compression = 0;
+    unsigned photometric = 0;
+    unsigned jpeg_offset = 0, jpeg_length = 0;
+    unsigned strip_offset = 0, strip_length = 0;
+    bool single_strip = false;
+    std::vector<unsigned> sub_ifds;
+    for (unsigned i = 0; i < num_entries; ++i) {
+      unsigned short tag, format;
+      unsigned length, data;
+      parseIFEntryHeader(ifd.data() + 12 * i, alignIntel, tag, format, length,
+                         data);
+      const unsigned value = format == 3 ? shortValue(data) : data;
+      switch (tag) {
+        case 0x103:
+          // Compression
+          compression = value;
+          break;
+
+        case 0x106:
+          // PhotometricInterpretation
+          photometric = value;
+          break;
+
+        case 0x111:
+          // StripOffsets
+          single_strip = length == 1;
+          strip_offset = value;
+          break;
+
+        case 0x117:
+          // StripByteCounts
+          strip_length = value;
+          break;
+
+        case 0x14A:
+          // SubIFDs, either the offset itself or an offset to the array
+          if (length == 1) {
+            sub_ifds.push_back(data);
+          } else if (length > 1 && length <= 16) {
+            std::vector<unsigned char> offsets(4 * length);
+            if (readAt(data, offsets.data(),
+                       static_cast<unsigned>(offsets.size())))
+              for (unsigned j = 0; j < length; ++j)
+                sub_ifds.push_back(
+                    parse_value<uint32_t>(offsets.data() + 4 * j, alignIntel));
+          }
+          break;
+
+        case 0x201:
+          // JPEGInterchangeFormat
+          jpeg_offset = data;
+          break;
+
+        case 0x202:
+          // JPEGInterchangeFormatLength
+          jpeg_length = data;
+          break;
+      }
+    }
+
+    if (jpeg_offset && jpeg_length) addCandidate(jpeg_offset, jpeg_length);
+    // a JPEG stored as a single strip (CR2 IFD0, DNG previews), CFA and
+    // linear raw data are never previews
+    if ((compression == 6 || compression == 7) && single_strip &&
+        photometric != 32803 && photometric != 34892)
+      addCandidate(strip_offset, strip_length);
+
+    for (unsigned sub_ifd : sub_ifds) {
+      if (sub_ifd) walkIFD(sub_ifd, depth + 1);
+    }
+
+    return has_next ? parse_value<uint32_t>(ifd.data() + 12 * num_entries,
+                                            alignIntel)
+                    : 0;
+  }
+};
+
+}  // namespace
+
+int tinyexif::findJPEGPreview(ReadCallback read, void *user,
+                              unsigned long long fileSize,
+                              JPEGPreview &preview) {
+  // TIFF header:
+  //  2 bytes: 'II' or 'MM'
+  //  2 bytes: 0x002a (raw formats use their own magic, e.g. 0x4f52 for ORF)
+  //  4 bytes: offset to first IFD
+  unsigned char header[8];
+  if (!read || fileSize < 8 || !read(user, 0, header, 8))
+    return PARSE_EXIF_ERROR_CORRUPT;
+
+  TIFFWalker walker{read, user, fileSize, true, 0, false, JPEGPreview{}};
+  if (header[0] == 'I' && header[1] == 'I')
+    walker.alignIntel = true;
+  else if (header[0] == 'M' && header[1] == 'M')
+    walker.alignIntel = false;
+  else
+    return PARSE_EXIF_ERROR_UNKNOWN_BYTEALIGN;
+
+  if (!isTIFFMagic(parse_value<uint16_t>(header + 2, walker.alignIntel)))
+    return PARSE_EXIF_ERROR_CORRUPT;
+
+  unsigned ifd_offset = parse_value<uint32_t>(header + 4, walker.alignIntel);
+  for (int i = 0; i < 16 && ifd_offset; ++i) {
+    ifd_offset = walker.walkIFD(ifd_offset, 0);
+  }
+
+  if (!walker.found) return PARSE_EXIF_ERROR_NO_PREVIEW;
+  preview = walker.best;
+  return PARSE_EXIF_SUCCESS;
 }
@@ -52,11 +52,30 @@ class EXIFInfo {
   int parseFrom(const unsigned char *data, unsigned length);
   int parseFrom(const std::string &data);
 
+  // Parsing function for the start of a JPEG image. Walks the markers by
+  // segment length up to the start of the scan instead of scanning the whole
+  // image, so only the first 64-128 KB of the file have to be read. Takes
+  // ImageWidth and ImageHeight from the frame header if the EXIF data does
+  // not have them.
+  //
+  // PARAM 'data': A pointer to the start of a JPEG image.
+  // PARAM 'length': The number of bytes available.
+  // RETURN:  PARSE_EXIF_SUCCESS (0) on succes with 'result' filled out
+  //          PARSE_EXIF_ERROR_TRUNCATED if the EXIF segment is not within
+  //          'length' bytes (read more of the file or use parseFrom())
+  //          error code otherwise, as defined by the PARSE_EXIF_ERROR_* macros
+  int parseFromHeader(const unsigned char *data, unsigned length);
+
   // Parsing function for an EXIF segment. This is used internally by
   // parseFrom() but can be called for special cases where only the EXIF section
   // is available (i.e., a blob starting with the bytes "Exif\0\0").
   int parseFromEXIFSegment(const unsigned char *buf, unsigned len);
 
+  // Parsing function for a bare TIFF structure (a blob starting with "II" or
+  // "MM"), such as the header of a TIFF based raw file. Offsets past 'len'
+  // are ignored, so the first few KB of the file are usually enough.
+  int parseFromTIFF(const unsigned char *buf, unsigned len);
+
   // Set all data members to default values.
   void clear();
 
@@ -150,10 +169,113 @@ class EXIFInfo {
     std::string Make;              // Lens manufacturer
     std::string Model;             // Lens model
   } LensInfo;
+  unsigned ThumbnailOffset;  // Offset of the JPEG thumbnail (IFD1) from the
+                             // start of the buffer passed to parseFrom() (or
+                             // parseFromEXIFSegment() when called directly)
+  unsigned ThumbnailLength;  // Length of the JPEG thumbnail, 0 if there is none
 
   EXIFInfo() { clear(); }
 };
 
+//
+// String of an EXIFRecord, stored in its arena (not null terminated)
+//
+struct EXIFStringRef {
+  unsigned short Offset;  // Offset into EXIFRecord::Arena
+  unsigned short Length;  // 0 if the tag was not found
+};
+
+//
+// Fixed size POD alternative to EXIFInfo for parsing many files: filled out
+// without any heap allocation and can be copied with memcpy (or written to a
+// file as is). Strings are copied into the inline arena and truncated when it
+// is full. GPS data, the user comment and the rarely used values are skipped.
+//
+struct EXIFRecord {
+  char ByteAlign;                    // 0 = Motorola byte alignment, 1 = Intel
+  unsigned short Orientation;        // Same values as EXIFInfo::Orientation
+  unsigned short BitsPerSample;      // Number of bits per component
+  unsigned short ExposureProgram;    // Same values as EXIFInfo::ExposureProgram
+  unsigned short ISOSpeedRatings;    // ISO speed
+  unsigned short MeteringMode;       // Same values as EXIFInfo::MeteringMode
+  unsigned short FocalLengthIn35mm;  // Focal length in 35mm film
+  char Flash;                        // 0 = no flash, 1 = flash used
+  char FlashReturnedLight;           // Same values as EXIFInfo
+  char FlashMode;                    // Same values as EXIFInfo
+  unsigned ImageWidth;               // Image width reported in EXIF data
+  unsigned ImageHeight;              // Image height reported in EXIF data
+  double ExposureTime;               // Exposure time in seconds
+  double FNumber;                    // F/stop
+  double ExposureBiasValue;          // Exposure bias value in EV
+  double SubjectDistance;            // Distance to focus point in meters
+  double FocalLength;                // Focal length of lens in millimeters
+  double LensFocalLengthMin;         // Min focal length (mm)
+  double LensFocalLengthMax;         // Max focal length (mm)
+  double LensFStopMin;               // Min aperture (f-stop)
+  double LensFStopMax;               // Max aperture (f-stop)
+  unsigned ThumbnailOffset;          // Same as EXIFInfo::ThumbnailOffset
+  unsigned ThumbnailLength;          // Length of the JPEG thumbnail
+  EXIFStringRef ImageDescription;    // Image description
+  EXIFStringRef Make;                // Camera manufacturer's name
+  EXIFStringRef Model;               // Camera model
+  EXIFStringRef Software;            // Software used
+  EXIFStringRef DateTime;            // File change date and time
+  EXIFStringRef DateTimeOriginal;    // Original file date and time
+  EXIFStringRef DateTimeDigitized;   // Digitization date and time
+  EXIFStringRef SubSecTimeOriginal;  // Sub-second time of DateTimeOriginal
+  EXIFStringRef Copyright;           // File copyright information
+  EXIFStringRef LensMake;            // Lens manufacturer
+  EXIFStringRef LensModel;           // Lens model
+  unsigned short ArenaUsed;          // Bytes used in Arena
+  char Arena[256];                   // Storage of the strings
+
+  // Copies a string out of the arena
+  std::string str(EXIFStringRef ref) const {
+    return std::string(Arena + ref.Offset, ref.Length);
+  }
+};
+
+// Zero allocation counterparts of EXIFInfo::parseFromHeader(),
+// EXIFInfo::parseFromEXIFSegment() and EXIFInfo::parseFromTIFF(), with the
+// same return codes. 'record' is cleared first. parseFromTIFF() also accepts
+// the headers of ORF and RW2 files, like findJPEGPreview().
+int parseFromHeader(const unsigned char *data, unsigned length,
+                    EXIFRecord &record);
+int parseFromEXIFSegment(const unsigned char *buf, unsigned len,
+                         EXIFRecord &record);
+int parseFromTIFF(const unsigned char *buf, unsigned len, EXIFRecord &record);
+
+//
+// Reads 'size' bytes at 'offset' of a file into 'dst'.
+// RETURN: true if all the bytes were read
+//
+typedef bool (*ReadCallback)(void *user, unsigned long long offset,
+                             unsigned char *dst, unsigned size);
+
+//
+// JPEG preview embedded in a TIFF based raw file (ARW, NEF, CR2, DNG, ...)
+//
+struct JPEGPreview {
+  unsigned long long Offset;  // Offset of the JPEG from the start of the file
+  unsigned Length;            // Length of the JPEG
+  unsigned Width;             // Width from the JPEG frame header
+  unsigned Height;            // Height from the JPEG frame header
+};
+
+// Walks the IFD chain (IFD0, IFD1, ...) and the SubIFDs of a TIFF based raw
+// file and finds the largest embedded JPEG preview that is baseline or
+// progressive (lossless JPEG raw data is skipped). Only the TIFF header, the
+// IFDs and the JPEG frame headers are read, through 'read'.
+//
+// PARAM 'read': Callback that reads a range of the file.
+// PARAM 'user': Passed to 'read'.
+// PARAM 'fileSize': Size of the file.
+// PARAM 'preview': Filled out with the largest preview.
+// RETURN:  PARSE_EXIF_SUCCESS (0) on success
+//          error code otherwise, as defined by the PARSE_EXIF_ERROR_* macros
+int findJPEGPreview(ReadCallback read, void *user,
+                    unsigned long long fileSize, JPEGPreview &preview);
+
 }  // namespace tinyexif
 
 // Parse was successful
@@ -166,5 +288,9 @@ class EXIFInfo {
 #define PARSE_EXIF_ERROR_UNKNOWN_BYTEALIGN 1984
 // EXIF header was found, but data was corrupted.
 #define PARSE_EXIF_ERROR_CORRUPT 1985
+// No decodable JPEG preview found in the raw file.
+#define PARSE_EXIF_ERROR_NO_PREVIEW 1986
+// The buffer ended before the EXIF segment or the start of the scan.
+#define PARSE_EXIF_ERROR_TRUNCATED 1987
 
 #endif
@@ -0,0 +1,177 @@
+// Compares the directory scan of `ImageViewport::LoadFilesFromDir` before
+// `utils::ScanDirectory` (two `directory_iterator` passes plus `exists` and
+// `is_directory` for each entry) with the single-pass scanner.
+//
+// The `stat` family and `readdir` are interposed to count the calls that
+// reach libc, each `stat` is one syscall (`readdir` reads the entries in
+// batches, see `strace -c` for the `getdents64` count).
+//
+// Build and run with "scripts/benchScan.sh".
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <algorithm>
+#include <dlfcn.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "directoryScanner.hpp"
+
+
+namespace {
+
+uint64_t g_statCalls = 0;
+uint64_t g_readdirCalls = 0;
+
+} // namespace
+
+
+// interposed libc functions, they forward to the next definition
+extern "C" {
+
+int stat(const char* path, struct stat* buf) {
+    using Fn = int (*)(const char*, struct stat*);
+    static const Fn next = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, "stat"));
+    ++g_statCalls;
+    return next(path, buf);
+}
+
+int lstat(const char* path, struct stat* buf) {
+    using Fn = int (*)(const char*, struct stat*);
+    static const Fn next = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, "lstat"));
+    ++g_statCalls;
+    return next(path, buf);
+}
+
+int fstatat(int dirfd, const char* path, struct stat* buf, int flags) {
+    using Fn = int (*)(int, const char*, struct stat*, int);
+    static const Fn next = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, "fstatat"));
+    ++g_statCalls;
+    return next(dirfd, path, buf, flags);
+}
+
+struct dirent* readdir(DIR* dir) {
+    using Fn = struct dirent* (*)(DIR*);
+    static const Fn next = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, "readdir"));
+    ++g_readdirCalls;
+    return next(dir);
+}
+
+}
+
+
+namespace {
+
+// `utils::IsValidImage` before the scanner
+bool IsValidImageOld(const char* filePath) {
+    if (!std::filesystem::exists(filePath)) {
+        return false;
+    } else if (std::filesystem::is_directory(filePath)) {
+        return false;
+    }
+
+    return utils::HasImageExtension(filePath);
+}
+
+uint64_t ScanOld(const std::string& directory) {
+    std::vector<std::string> images;
+    const std::filesystem::path filesPath{ directory };
+    images.reserve(std::distance(
+        std::filesystem::directory_iterator(filesPath),
+        std::filesystem::directory_iterator()
+    ));
+
+    for (const auto& file : std::filesystem::directory_iterator{ filesPath }) {
+        const std::string fpath = file.path().string();
+        if (!IsValidImageOld(fpath.c_str())) {
+            continue;
+        }
+
+        images.emplace_back(fpath);
+    }
+
+    return images.size();
+}
+
+uint64_t ScanNew(const std::string& directory) {
+    std::vector<std::string> images;
+    utils::ScanDirectory(directory, [&images](const std::string& filepath) {
+        images.emplace_back(filepath);
+        return true;
+    });
+
+    return images.size();
+}
+
+// a camera card: JPEGs with their raws and sidecars, and a few directories
+void CreateEntries(const std::string& directory, const uint64_t count) {
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    char name[64];
+    for (uint64_t i = 0; i < count; ++i) {
+        const uint64_t kind = i % 20;
+        if (kind == 19) {
+            snprintf(name, sizeof(name), "/DIR%06llu", static_cast<unsigned long long>(i));
+            mkdir((directory + name).c_str(), 0755);
+            continue;
+        }
+
+        const char* ext = kind < 12 ? ".JPG" : kind < 17 ? ".ARW" : ".xmp";
+        snprintf(name, sizeof(name), "/DSC%06llu%s", static_cast<unsigned long long>(i), ext);
+        const int fd = open((directory + name).c_str(), O_CREAT | O_WRONLY, 0644);
+        if (fd >= 0)
+            close(fd);
+    }
+}
+
+template<typename ScanFn>
+void Run(const char* label, const std::string& directory, ScanFn scan) {
+    constexpr int repeats = 5;
+    double best = 1e30;
+    uint64_t images = 0;
+    uint64_t statCalls = 0;
+    uint64_t readdirCalls = 0;
+
+    for (int i = 0; i < repeats; ++i) {
+        g_statCalls = 0;
+        g_readdirCalls = 0;
+        const auto start = std::chrono::steady_clock::now();
+        images = scan(directory);
+        const auto end = std::chrono::steady_clock::now();
+        statCalls = g_statCalls;
+        readdirCalls = g_readdirCalls;
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    printf("  %-5s %8llu images %9llu stat %9llu readdir %10.2f ms\n", label,
+        static_cast<unsigned long long>(images),
+        static_cast<unsigned long long>(statCalls),
+        static_cast<unsigned long long>(readdirCalls), best);
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[]) {
+    const std::string root = argc > 1 ? argv[1] : "/tmp/photoViewerBenchScan";
+
+    for (const uint64_t count : { 1000ull, 10000ull, 100000ull }) {
+        const std::string directory = root + "/" + std::to_string(count);
+        CreateEntries(directory, count);
+
+        printf("%llu entries (warm cache, best of 5)\n", static_cast<unsigned long long>(count));
+        Run("old", directory, ScanOld);
+        Run("new", directory, ScanNew);
+    }
+
+    std::filesystem::remove_all(root);
+    return 0;
+}
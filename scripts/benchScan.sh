@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# usage: scripts/benchScan.sh [scratch directory]
+
+mkdir -p build/bench/ &&
+g++ -std=c++17 -O2 -Isrc/ scripts/benchScan.cpp src/directoryScanner.cpp -ldl -o build/bench/benchScan &&
+./build/bench/benchScan "$@"
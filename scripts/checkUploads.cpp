@@ -0,0 +1,245 @@
+// Runs `TextureUploader` against a real OpenGL context and checks what ends
+// up in the textures, for both of its buffer paths: persistently mapped
+// (`GL_ARB_buffer_storage`) and mapped for each fill (the extension turned
+// off).
+//
+// The context is created without a window through surfaceless EGL (eg: Mesa
+// llvmpipe, no display or GPU needed), with the rlgl and glad of raylib. Each
+// frame ends with `glFlush` in place of the buffer swap. Every mipmap level
+// is read back with `glGetTexImage` and compared with the source pixels, one
+// of the images is cancelled while its upload is queued and another one
+// while its bands are in flight.
+//
+// Build and run with "scripts/checkUploads.sh".
+
+// before the OpenGL headers of glad
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "raylib/src/external/glad.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include "raylib.h"
+#include "rlgl.h"
+#include "textureUploader.hpp"
+
+
+// the parts of raylib that `TextureUploader` uses, without a window
+void TraceLog(int, const char* text, ...) {
+    va_list args;
+    va_start(args, text);
+    vprintf(text, args);
+    va_end(args);
+    printf("\n");
+}
+
+int GetPixelDataSize(int width, int height, int format) {
+    const int bytes = format == PIXELFORMAT_UNCOMPRESSED_GRAYSCALE ? 1
+        : format == PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA ? 2
+        : format == PIXELFORMAT_UNCOMPRESSED_R8G8B8 ? 3 : 4;
+    return width * height * bytes;
+}
+
+Texture2D LoadTextureFromImage(Image image) {
+    return Texture2D{
+        .id = rlLoadTexture(image.data, image.width, image.height, image.format, image.mipmaps),
+        .width = image.width,
+        .height = image.height,
+        .mipmaps = image.mipmaps,
+        .format = image.format,
+    };
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ElapsedMs(const Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int HalveSize(const int size) {
+    return size > 1 ? size / 2 : 1;
+}
+
+// RGBA8 with the whole mip chain, filled with a pattern that differs per image
+Image MakeImage(const int width, const int height, const unsigned seed) {
+    int mipmaps = 1;
+    for (int size = std::max(width, height); size > 1; size /= 2) {
+        ++mipmaps;
+    }
+
+    size_t total = 0;
+    for (int i = 0, w = width, h = height; i < mipmaps; ++i, w = HalveSize(w), h = HalveSize(h)) {
+        total += static_cast<size_t>(w) * static_cast<size_t>(h) * 4;
+    }
+
+    auto* data = static_cast<unsigned char*>(malloc(total));
+    for (size_t i = 0; i < total; ++i) {
+        data[i] = static_cast<unsigned char>((i * 2654435761u + seed) >> 7);
+    }
+
+    return Image{ data, width, height, mipmaps, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+}
+
+bool Verify(const unsigned int textureId, const Image& image) {
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    std::vector<unsigned char> pixels;
+    size_t offset = 0;
+    bool matches = true;
+    for (int i = 0, w = image.width, h = image.height; i < image.mipmaps; ++i, w = HalveSize(w), h = HalveSize(h)) {
+        const size_t size = static_cast<size_t>(w) * static_cast<size_t>(h) * 4;
+        pixels.assign(size, 0);
+        glGetTexImage(GL_TEXTURE_2D, i, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        if (std::memcmp(pixels.data(), static_cast<const unsigned char*>(image.data) + offset, size) != 0) {
+            printf("  level %d (%dx%d) of texture %u differs\n", i, w, h, textureId);
+            matches = false;
+        }
+        offset += size;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return matches;
+}
+
+// @returns false if a texture does not match its image or GL reported an error
+bool Run(const char* label, const bool persistent) {
+    GLAD_GL_ARB_buffer_storage = persistent ? 1 : 0;
+    TextureUploader uploader;
+
+    std::vector<Image> images{
+        MakeImage(6000, 4000, 1),
+        MakeImage(4000, 3000, 2),
+        MakeImage(1000, 667, 3),
+        MakeImage(3000, 2000, 4),
+    };
+    std::vector<Texture2D> textures;
+    for (const Image& image : images) {
+        textures.push_back(uploader.Upload(image));
+    }
+    // queued behind the others
+    Image queued = MakeImage(5000, 5000, 5);
+    const Texture2D queuedTexture = uploader.Upload(queued);
+
+    int frames = 0;
+    size_t completedCount = 0;
+    double totalMs = 0.0;
+    double worstMs = 0.0;
+    std::vector<unsigned int> completed;
+    while (!uploader.Empty() && frames < 1000) {
+        const Clock::time_point start = Clock::now();
+        uploader.Update(completed);
+        const double ms = ElapsedMs(start);
+        totalMs += ms;
+        worstMs = std::max(worstMs, ms);
+        completedCount += completed.size();
+
+        if (frames == 1) {
+            // the first image has bands in flight
+            uploader.Cancel(textures[0].id);
+            rlUnloadTexture(textures[0].id);
+            textures[0].id = 0;
+            ++completedCount;
+        } else if (frames == 3) {
+            uploader.Cancel(queuedTexture.id);
+            rlUnloadTexture(queuedTexture.id);
+        }
+
+        // the swap at the end of a frame
+        glFlush();
+        ++frames;
+    }
+
+    bool success = completedCount == images.size();
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (textures[i].id != 0) {
+            success = Verify(textures[i].id, images[i]) && success;
+        }
+    }
+    const GLenum error = glGetError();
+    success = success && error == GL_NO_ERROR;
+    printf("%s: %zu textures in %d frames, Update %.2fms avg / %.2fms worst, glGetError 0x%x: %s\n",
+        label, completedCount, frames, totalMs / std::max(frames, 1), worstMs, error,
+        success ? "OK" : "FAILED");
+
+    // the same images at once, for comparison
+    const Clock::time_point start = Clock::now();
+    for (size_t i = 1; i < images.size(); ++i) {
+        rlUnloadTexture(LoadTextureFromImage(images[i]).id);
+    }
+    glFinish();
+    printf("%s: the same textures with glTexImage2D took %.1fms in one frame\n", label, ElapsedMs(start));
+
+    for (const Texture2D& texture : textures) {
+        rlUnloadTexture(texture.id);
+    }
+    for (Image& image : images) {
+        free(image.data);
+    }
+    free(queued.data);
+
+    return success;
+}
+
+} // namespace
+
+
+int main() {
+    const auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    const EGLDisplay display = getPlatformDisplay != nullptr
+        ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr)
+        : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major = 0;
+    EGLint minor = 0;
+    if (!eglInitialize(display, &major, &minor)) {
+        printf("eglInitialize failed (0x%x)\n", eglGetError());
+        return 1;
+    }
+
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+
+    // same version as raylib asks GLFW for
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    const EGLContext context = eglCreateContext(display,
+        numConfigs > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        printf("Failed to create a surfaceless OpenGL 3.3 context (0x%x)\n", eglGetError());
+        eglTerminate(display);
+        return 1;
+    }
+
+    rlLoadExtensions(reinterpret_cast<void*>(eglGetProcAddress));
+    printf("EGL %d.%d, %s, OpenGL %s\n", major, minor,
+        reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+        reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+    bool success = true;
+    if (GLAD_GL_ARB_buffer_storage != 0) {
+        success = Run("persistently mapped", true) && success;
+    } else {
+        printf("GL_ARB_buffer_storage is not supported, skipping the persistent mapping\n");
+    }
+    success = Run("mapped for each fill", false) && success;
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+
+    return success ? 0 : 1;
+}
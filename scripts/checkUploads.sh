@@ -0,0 +1,11 @@
+#!/bin/bash
+
+# usage: scripts/checkUploads.sh
+# needs the EGL headers and a Mesa driver (eg: llvmpipe), no display
+
+mkdir -p build/bench/ &&
+printf '#define RLGL_IMPLEMENTATION\n#define GRAPHICS_API_OPENGL_33\n#include "raylib.h"\n#include "rlgl.h"\n' |
+    gcc -x c -O2 -Iext/raylib/src/ -c - -o build/bench/rlgl.o &&
+g++ -std=c++20 -O2 -Isrc/ -Iext/ -Iext/raylib/src/ scripts/checkUploads.cpp src/textureUploader.cpp \
+    build/bench/rlgl.o -lEGL -ldl -lm -o build/bench/checkUploads &&
+EGL_PLATFORM=surfaceless ./build/bench/checkUploads "$@"
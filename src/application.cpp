@@ -1,10 +1,114 @@
 #include "application.hpp"
 
+#include <algorithm>
+#include <utility>
 #include <GLFW/glfw3.h>
 
 #include "imgui.h"
 
 #include "ui.hpp"
+#include "bufferPool.hpp"
+#include "utils.hpp"
+#include "logger.hpp"
+
+
+namespace {
+
+const char* GetTextureFilteringName(const TextureFiltering filtering) {
+    switch (filtering) {
+        case TextureFiltering::POINT: return "point";
+        case TextureFiltering::BILINEAR: return "bilinear";
+        case TextureFiltering::TRILINEAR: return "trilinear";
+    }
+
+    return "";
+}
+
+// set by the callbacks below, that are called before the ones of raylib,
+// so that its queues of key presses are left to `ProcessInput` and ImGui
+struct InputEvents {
+    bool received = false; // since the last `HasInput`
+    int keysDown = 0;
+    int buttonsDown = 0;
+
+    GLFWkeyfun key = nullptr;
+    GLFWcharfun character = nullptr;
+    GLFWmousebuttonfun mouseButton = nullptr;
+    GLFWcursorposfun cursorPos = nullptr;
+    GLFWscrollfun scroll = nullptr;
+    GLFWwindowsizefun windowSize = nullptr;
+    GLFWdropfun drop = nullptr;
+};
+
+InputEvents inputEvents;
+
+void OnKey(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    inputEvents.received = true;
+    // (GLFW releases the keys that are down when the window loses the focus)
+    if (action == GLFW_PRESS) {
+        ++inputEvents.keysDown;
+    } else if (action == GLFW_RELEASE && inputEvents.keysDown > 0) {
+        --inputEvents.keysDown;
+    }
+
+    if (inputEvents.key != nullptr)
+        inputEvents.key(window, key, scancode, action, mods);
+}
+
+void OnChar(GLFWwindow* window, unsigned int codepoint) {
+    inputEvents.received = true;
+    if (inputEvents.character != nullptr)
+        inputEvents.character(window, codepoint);
+}
+
+void OnMouseButton(GLFWwindow* window, int button, int action, int mods) {
+    inputEvents.received = true;
+    if (action == GLFW_PRESS) {
+        ++inputEvents.buttonsDown;
+    } else if (action == GLFW_RELEASE && inputEvents.buttonsDown > 0) {
+        --inputEvents.buttonsDown;
+    }
+
+    if (inputEvents.mouseButton != nullptr)
+        inputEvents.mouseButton(window, button, action, mods);
+}
+
+void OnCursorPos(GLFWwindow* window, double x, double y) {
+    inputEvents.received = true;
+    if (inputEvents.cursorPos != nullptr)
+        inputEvents.cursorPos(window, x, y);
+}
+
+void OnScroll(GLFWwindow* window, double x, double y) {
+    inputEvents.received = true;
+    if (inputEvents.scroll != nullptr)
+        inputEvents.scroll(window, x, y);
+}
+
+void OnWindowSize(GLFWwindow* window, int width, int height) {
+    inputEvents.received = true;
+    if (inputEvents.windowSize != nullptr)
+        inputEvents.windowSize(window, width, height);
+}
+
+void OnDrop(GLFWwindow* window, int count, const char** paths) {
+    inputEvents.received = true;
+    if (inputEvents.drop != nullptr)
+        inputEvents.drop(window, count, paths);
+}
+
+// chains to the callbacks of raylib (ImGui chains to these in turn)
+void InstallInputCallbacks(GLFWwindow* window) {
+    inputEvents.key = glfwSetKeyCallback(window, OnKey);
+    inputEvents.character = glfwSetCharCallback(window, OnChar);
+    inputEvents.mouseButton = glfwSetMouseButtonCallback(window, OnMouseButton);
+    inputEvents.cursorPos = glfwSetCursorPosCallback(window, OnCursorPos);
+    inputEvents.scroll = glfwSetScrollCallback(window, OnScroll);
+    inputEvents.windowSize = glfwSetWindowSizeCallback(window, OnWindowSize);
+    inputEvents.drop = glfwSetDropCallback(window, OnDrop);
+}
+
+} // namespace
 
 
 Application::Application(const Config& config)
@@ -27,6 +131,7 @@ void Application::Init() {
     InitWindow(_config.windowWidth, _config.windowHeight, "Photo Viewer");
     SetExitKey(KEY_NULL);
     SetTargetFPS(60);
+    InstallInputCallbacks(static_cast<GLFWwindow*>(GetWindowHandle()));
 
     ui::InitUI();
 
@@ -37,11 +142,32 @@ void Application::Init() {
         .rawImageExt = _config.rawImageExt.c_str(),
         .windowWidth = _config.windowWidth,
         .windowHeight = _config.windowHeight,
+        .textureCacheSize = _config.textureCacheSize * 1024 * 1024,
+        .imageCacheSize = _config.imageCacheSize * 1024 * 1024,
+        .textureFiltering = _config.textureFiltering,
     };
     _viewport = std::make_unique<ImageViewport>(viewportInfo);
+
+    _startTime = _statsStartTime = GetTime();
+    _startCpu = _statsStartCpu = utils::GetProcessCpuTime();
 }
 
 void Application::Cleanup() {
+    const double elapsed = GetTime() - _startTime;
+    const double cpuTime = utils::GetProcessCpuTime() - _startCpu;
+    if (elapsed > 0.0 && _startCpu >= 0.0) {
+        logger::info("Waited for input %.1f%% of the time, average CPU usage %.1f%%",
+            _totalWaitTime / elapsed * 100.0, cpuTime / elapsed * 100.0);
+    }
+
+    const BufferPoolStats pool = BufferPool::Get().GetStats();
+    logger::info("Decode buffers: %.1fMB peak, %.1fMB at exit (%.1fMB idle), %llu of %llu allocations reused",
+        static_cast<double>(pool.peakBytes) / (1024.0 * 1024.0),
+        static_cast<double>(pool.usedBytes + pool.idleBytes) / (1024.0 * 1024.0),
+        static_cast<double>(pool.idleBytes) / (1024.0 * 1024.0),
+        static_cast<unsigned long long>(pool.hits),
+        static_cast<unsigned long long>(pool.hits + pool.misses));
+
     _viewport->Cleanup();
     ui::CleanupUI();
     // cleanup raylib
@@ -50,16 +176,25 @@ void Application::Cleanup() {
 
 void Application::Run() {
     while(!WindowShouldClose()) {
-        BeginDrawing();
-        ClearBackground(GetColor(0x282828FF));
+        _viewport->Update();
+
+        if (IsIdle()) {
+            // the frame on screen is still valid, skip drawing it again
+            WaitForInput();
+        } else {
+            BeginDrawing();
+            ClearBackground(GetColor(0x282828FF));
 
-        Draw();
+            Draw();
 
-        ui::BeginUI();
-        DrawUI();
-        ui::EndUI();
+            ui::BeginUI();
+            DrawUI();
+            ui::EndUI();
 
-        EndDrawing();
+            EndDrawing();
+            UpdateIdleStats(0.0);
+            UpdateFrameStats();
+        }
 
         ProcessInput();
         OnResize();
@@ -72,6 +207,52 @@ void Application::Draw() {
 
 #ifdef _DEBUG
     DrawFPS(10, 10);
+
+    const CacheStats stats = _viewport->GetCacheStats();
+    DrawText(TextFormat("Cache: %llu hits, %llu misses, %llu images, %.1fMB VRAM (+%.1fMB tiles), %.1fMB RAM",
+            static_cast<unsigned long long>(stats.hits),
+            static_cast<unsigned long long>(stats.misses),
+            static_cast<unsigned long long>(stats.entries),
+            static_cast<double>(stats.textureBytes) / (1024.0 * 1024.0),
+            static_cast<double>(_viewport->GetTileTextureBytes()) / (1024.0 * 1024.0),
+            static_cast<double>(stats.imageBytes) / (1024.0 * 1024.0)),
+        10, 35, 20, LIME);
+
+    const CatalogProgress catalog = _viewport->GetCatalogProgress();
+    DrawText(TextFormat("Catalog: %llu/%llu indexed, sorted by %s, camera: %s",
+            static_cast<unsigned long long>(catalog.indexed),
+            static_cast<unsigned long long>(catalog.total),
+            _viewport->GetSortOrder() == SortOrder::NAME ? "name" : "date taken",
+            _viewport->GetCameraFilter().empty() ? "all" : _viewport->GetCameraFilter().c_str()),
+        10, 60, 20, LIME);
+
+    const ImageCounter counter = _viewport->GetImageCounter();
+    DrawText(TextFormat("Image list: %llu images, %.1f bytes per image",
+            static_cast<unsigned long long>(counter.count),
+            counter.count > 0
+                ? static_cast<double>(_viewport->GetImageListMemory()) / static_cast<double>(counter.count)
+                : 0.0),
+        10, 85, 20, LIME);
+
+    DrawText(TextFormat("Texture filtering: %s, frame time: %.2fms (%.2fms worst while navigating)",
+            GetTextureFilteringName(_config.textureFiltering), GetFrameTime() * 1000.0f,
+            _worstNavFrameTime * 1000.0),
+        10, 110, 20, LIME);
+
+    if (_statsStartCpu >= 0.0) {
+        DrawText(TextFormat("CPU: %.1f%%, waited for input %.0f%% of the time, %llu frames skipped",
+                _cpuUsage, _waitShare, static_cast<unsigned long long>(_skippedFrames)),
+            10, 135, 20, LIME);
+    }
+
+    const BufferPoolStats pool = BufferPool::Get().GetStats();
+    DrawText(TextFormat("Decode buffers: %.1fMB used, %.1fMB idle, %.1fMB peak, %llu/%llu reused",
+            static_cast<double>(pool.usedBytes) / (1024.0 * 1024.0),
+            static_cast<double>(pool.idleBytes) / (1024.0 * 1024.0),
+            static_cast<double>(pool.peakBytes) / (1024.0 * 1024.0),
+            static_cast<unsigned long long>(pool.hits),
+            static_cast<unsigned long long>(pool.hits + pool.misses)),
+        10, 160, 20, LIME);
 #endif
 }
 
@@ -79,7 +260,8 @@ void Application::DrawUI() {
     if (!_showUI)
         return;
 
-    ui::CreateImageInfoWindow(_viewport->GetCurrentImageInfo(), _showImageInfo);
+    ui::CreateImageInfoWindow(_viewport->GetCurrentImageInfo(),
+        _viewport->GetImageCounter(), _viewport->GetTrashStatus(), _showImageInfo);
 
     ui::CreateConfigWindow(
         _textFields,
@@ -140,8 +322,18 @@ void Application::ProcessInput() {
 
     const float scroll = GetMouseWheelMove();
 
+    // CTRL+Z to undo the last delete
+    if ((IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL))
+            && IsKeyPressed(KEY_Z)) {
+        _viewport->UndoDelete();
+    }
+    // CTRL+X to delete all the raw images that have no jpg/png
+    else if ((IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL))
+            && IsKeyPressed(KEY_X)) {
+        _viewport->DeleteOrphanRaws();
+    }
     // "scroll down" or "-" or "S" to zoom out
-    if ((scroll < 0.0f
+    else if ((scroll < 0.0f
         || IsKeyDown(KEY_MINUS)
         || IsKeyPressed(KEY_S)
         || IsKeyPressedRepeat(KEY_S))) {
@@ -172,12 +364,18 @@ void Application::ProcessInput() {
     else if (IsKeyPressed(KEY_R)) {
         _viewport->Reset();
     }
-    // "D" or "Right arrow" to view next image
-    else if ((IsKeyPressed(KEY_D) || IsKeyPressed(KEY_RIGHT))) {
+    // "D" or "Right arrow" to view next image (hold to skim)
+    else if ((IsKeyPressed(KEY_D)
+        || IsKeyPressedRepeat(KEY_D)
+        || IsKeyPressed(KEY_RIGHT)
+        || IsKeyPressedRepeat(KEY_RIGHT))) {
         _viewport->NextImage();
     }
-    // "A" or "Left arrow" to view previous image
-    else if ((IsKeyPressed(KEY_A) || IsKeyPressed(KEY_LEFT))) {
+    // "A" or "Left arrow" to view previous image (hold to skim)
+    else if ((IsKeyPressed(KEY_A)
+        || IsKeyPressedRepeat(KEY_A)
+        || IsKeyPressed(KEY_LEFT)
+        || IsKeyPressedRepeat(KEY_LEFT))) {
         _viewport->PrevImage();
     }
     // "HOME" key to go to the first image
@@ -192,6 +390,21 @@ void Application::ProcessInput() {
     else if (IsKeyPressed(KEY_DELETE) || IsKeyPressed(KEY_X)) {
         _viewport->DeleteImage();
     }
+    // "O" to sort the images by name or by date taken
+    else if (IsKeyPressed(KEY_O)) {
+        _viewport->ToggleSortOrder();
+    }
+    // "C" to show only the images taken with the camera of the current image
+    else if (IsKeyPressed(KEY_C)) {
+        _viewport->ToggleCameraFilter();
+    }
+    // "T" to switch the texture filtering (point, bilinear, trilinear)
+    else if (IsKeyPressed(KEY_T)) {
+        _config.textureFiltering = static_cast<TextureFiltering>(
+            (static_cast<int>(_config.textureFiltering) + 1) % 3);
+        _viewport->UpdateTextureFiltering(_config.textureFiltering);
+        logger::info("Texture filtering: %s", GetTextureFilteringName(_config.textureFiltering));
+    }
 
     // "Left click and drag" to move the image
     if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
@@ -236,3 +449,79 @@ void Application::UpdateImageInfo() {
     _viewport->UpdateTrashDir(_config.trashDir.c_str());
     _viewport->UpdateRawImageExt(_config.rawImageExt.c_str());
 }
+
+bool Application::IsIdle() {
+    // text inputs blink the cursor
+    if (HasInput() || ImGui::GetIO().WantTextInput || !_viewport->IsIdle()) {
+        _quietFrames = 0;
+        return false;
+    }
+
+    // ImGui needs a few frames after the input (eg: to size the windows)
+    if (_quietFrames < _settleFrames) {
+        ++_quietFrames;
+        return false;
+    }
+
+    return true;
+}
+
+void Application::WaitForInput() {
+    const double start = GetTime();
+
+    // polls the events like `EndDrawing` does (the key states of this frame
+    // become the previous ones), but blocks until there are any
+    EnableEventWaiting();
+    PollInputEvents();
+    DisableEventWaiting();
+
+    // the events might need a redraw even if they are not input (eg: the
+    // window was uncovered)
+    _quietFrames = 0;
+    ++_skippedFrames;
+    // the next frame is timed from the input
+    _lastFrameEnd = GetTime();
+    UpdateIdleStats(_lastFrameEnd - start);
+}
+
+bool Application::HasInput() {
+    // eg: "-" zooms out while it is held down, there are no events for it
+    return std::exchange(inputEvents.received, false)
+        || inputEvents.keysDown > 0
+        || inputEvents.buttonsDown > 0;
+}
+
+void Application::UpdateIdleStats(const double waitTime) {
+    _statsWaitTime += waitTime;
+    _totalWaitTime += waitTime;
+
+    const double now = GetTime();
+    const double elapsed = now - _statsStartTime;
+    if (elapsed < 1.0 || _statsStartCpu < 0.0)
+        return;
+
+    const double cpuTime = utils::GetProcessCpuTime();
+    _cpuUsage = (cpuTime - _statsStartCpu) / elapsed * 100.0;
+    _waitShare = _statsWaitTime / elapsed * 100.0;
+
+    _statsStartTime = now;
+    _statsStartCpu = cpuTime;
+    _statsWaitTime = 0.0;
+}
+
+void Application::UpdateFrameStats() {
+    const double now = GetTime();
+    const double frameTime = now - _lastFrameEnd;
+    _lastFrameEnd = now;
+
+    const double lastNav = _viewport->GetLastNavTime();
+    if (lastNav <= 0.0 || now - lastNav > _navFrameWindow)
+        return;
+
+    // a new navigation, the previous one is forgotten
+    if (lastNav - _lastNavTime > _navFrameWindow) {
+        _worstNavFrameTime = 0.0;
+    }
+    _lastNavTime = lastNav;
+    _worstNavFrameTime = std::max(_worstNavFrameTime, frameTime);
+}
@@ -29,6 +29,26 @@ private:
 
     void UpdateImageInfo();
 
+    /**
+     * @returns true if the next frame would be the same as the one on screen
+     *          (no input, nothing loading and no UI interaction)
+     */
+    bool IsIdle();
+
+    // blocks until there are input events, instead of drawing the same frame
+    void WaitForInput();
+
+    // input events since the last call (keys, mouse, resize, dropped files)
+    // or keys and mouse buttons held down, the queues of raylib are left as is
+    bool HasInput();
+
+    // updates the CPU usage and the time spent waiting, about once a second
+    void UpdateIdleStats(const double waitTime);
+
+    // keeps the longest frame drawn while navigating (until `_navFrameWindow`
+    // after the last move to another image)
+    void UpdateFrameStats();
+
 private:
     Config _config;
     std::unique_ptr<ImageViewport> _viewport;
@@ -36,4 +56,25 @@ private:
     bool _showConfig = false;
     bool _showUI = true;
     TextFields _textFields; // to temporarily store values from text inputs
+
+    // frames drawn after the input before waiting (so that ImGui can settle)
+    constexpr static uint32_t _settleFrames = 3;
+    uint32_t _quietFrames = 0; // consecutive frames without input
+
+    // idle stats (see `UpdateIdleStats`)
+    double _statsStartTime = 0.0;
+    double _statsStartCpu = 0.0;
+    double _statsWaitTime = 0.0;
+    uint64_t _skippedFrames = 0; // frames not drawn while waiting
+    double _cpuUsage = 0.0; // percentage of one core
+    double _waitShare = 0.0; // percentage of the time spent waiting
+    double _startTime = 0.0; // totals since the start
+    double _startCpu = 0.0;
+    double _totalWaitTime = 0.0;
+
+    // frame stats (see `UpdateFrameStats`)
+    constexpr static double _navFrameWindow = 1.0; // in seconds
+    double _lastFrameEnd = 0.0; // or the end of the wait for input
+    double _lastNavTime = 0.0;
+    double _worstNavFrameTime = 0.0; // of the last navigation, in seconds
 };
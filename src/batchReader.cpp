@@ -0,0 +1,499 @@
+#include "batchReader.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <algorithm>
+#include "bufferPool.hpp"
+#include "logger.hpp"
+#include "utils.hpp"
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/stat.h>
+#endif
+#if defined(__linux__)
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <linux/io_uring.h>
+#endif
+
+
+#if defined(__linux__)
+
+// the rings shared with the kernel, see io_uring_setup(2)
+struct IoUring {
+    int fd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+};
+
+namespace {
+
+void DestroyRing(IoUring* ring);
+
+// IORING_OP_READ came with Linux 5.6, a ring can be set up since 5.1 but
+// then fails every read with EINVAL (the probe is 5.6+ too, it fails the same)
+bool SupportsRead(const int fd) {
+    constexpr unsigned maxOps = 256; // `last_op` is 8 bits
+    std::vector<unsigned char> storage(sizeof(io_uring_probe) + maxOps * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, maxOps) < 0)
+        return false;
+
+    return IORING_OP_READ <= probe->last_op
+        && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) != 0;
+}
+
+// @returns nullptr if io_uring (with IORING_OP_READ) is not available
+IoUring* CreateRing(const unsigned entries) {
+    io_uring_params params{};
+    const int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0)
+        return nullptr;
+
+    if (!SupportsRead(fd)) {
+        close(fd);
+        return nullptr;
+    }
+
+    auto* ring = new IoUring{};
+    ring->fd = fd;
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap) {
+        ring->sqRingSize = ring->cqRingSize = std::max(ring->sqRingSize, ring->cqRingSize);
+    }
+
+    ring->sqRing = mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED) {
+        ring->sqRing = nullptr;
+        DestroyRing(ring);
+        return nullptr;
+    }
+
+    ring->cqRing = singleMmap ? ring->sqRing : mmap(nullptr, ring->cqRingSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (ring->cqRing == MAP_FAILED) {
+        ring->cqRing = nullptr;
+        DestroyRing(ring);
+        return nullptr;
+    }
+
+    ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        DestroyRing(ring);
+        return nullptr;
+    }
+    ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+    unsigned char* sq = static_cast<unsigned char*>(ring->sqRing);
+    unsigned char* cq = static_cast<unsigned char*>(ring->cqRing);
+    ring->sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring->sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return ring;
+}
+
+void DestroyRing(IoUring* ring) {
+    if (ring == nullptr)
+        return;
+
+    if (ring->sqes != nullptr) {
+        munmap(ring->sqes, ring->sqesSize);
+    }
+    if (ring->cqRing != nullptr && ring->cqRing != ring->sqRing) {
+        munmap(ring->cqRing, ring->cqRingSize);
+    }
+    if (ring->sqRing != nullptr) {
+        munmap(ring->sqRing, ring->sqRingSize);
+    }
+    close(ring->fd);
+    delete ring;
+}
+
+// queues a read, the kernel sees it after `SubmitAndWait`
+void PrepareRead(IoUring* ring,
+    const int fd,
+    void* dst,
+    const uint64_t size,
+    const uint64_t offset,
+    void* user) {
+    const unsigned tail = *ring->sqTail;
+    const unsigned index = tail & ring->sqMask;
+    io_uring_sqe& sqe = ring->sqes[index];
+    sqe = io_uring_sqe{};
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<uint64_t>(dst);
+    sqe.len = static_cast<uint32_t>(size);
+    sqe.off = offset;
+    sqe.user_data = reinterpret_cast<uint64_t>(user);
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Submits all the reads that the kernel has not consumed yet (including the
+ * ones left by a failed or partial submission before)
+ * @returns false if io_uring_enter failed, the reads stay queued in the ring
+ */
+bool SubmitAndWait(IoUring* ring, const unsigned minComplete) {
+    while (true) {
+        const unsigned toSubmit = *ring->sqTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+        const long result = syscall(__NR_io_uring_enter, ring->fd, toSubmit, minComplete,
+            minComplete > 0 ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+        if (result >= 0)
+            return true;
+        if (errno != EINTR)
+            return false;
+    }
+}
+
+} // namespace
+
+#else
+
+struct IoUring {};
+
+namespace {
+
+IoUring* CreateRing(const unsigned) {
+    return nullptr;
+}
+
+void DestroyRing(IoUring*) {}
+
+} // namespace
+
+#endif
+
+
+BatchReader::BatchReader(const uint32_t numThreads) {
+    _ring = CreateRing(_ringEntries);
+    if (_ring != nullptr) {
+        logger::info("Reading ahead with io_uring");
+        _threads.emplace_back(&BatchReader::RingLoop, this);
+        return;
+    }
+
+#if defined(_WIN32)
+    // nothing is read ahead, see `Submit`
+    (void)numThreads;
+#else
+    logger::info("Reading ahead with %u threads", numThreads);
+    for (uint32_t i = 0; i < std::max(numThreads, 1u); ++i) {
+        _threads.emplace_back(&BatchReader::ReadLoop, this);
+    }
+#endif
+}
+
+BatchReader::~BatchReader() {
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        _stop = true;
+    }
+    _wake.notify_all();
+
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+    DestroyRing(_ring);
+
+    for (auto& [filepath, read] : _reads) {
+        BufferPool::Get().Free(read.buffer);
+    }
+}
+
+void BatchReader::Submit(const std::vector<std::string>& filepaths) {
+#if defined(_WIN32)
+    // nothing is read ahead on Windows (there are no inodes to order the
+    // reads by), `Take` finds no file and the workers read their files
+    // themselves
+    (void)filepaths;
+#else
+    std::vector<FileRead> batch;
+    batch.reserve(filepaths.size());
+    for (const std::string& filepath : filepaths) {
+        if (utils::IsRawImage(filepath.c_str()))
+            continue;
+
+        struct stat st{};
+        if (stat(filepath.c_str(), &st) != 0 || st.st_size <= 0
+                || static_cast<uint64_t>(st.st_size) > _maxFileSize)
+            continue;
+
+        FileRead read{};
+        read.filepath = filepath;
+        read.inode = static_cast<uint64_t>(st.st_ino);
+        read.size = static_cast<uint64_t>(st.st_size);
+        read.modTime = static_cast<long>(st.st_mtime);
+        batch.push_back(std::move(read));
+    }
+    if (batch.empty())
+        return;
+
+    // the files of a directory are usually laid out on disk in the order
+    // their inodes were allocated
+    std::sort(batch.begin(), batch.end(),
+        [](const FileRead& a, const FileRead& b) { return a.inode < b.inode; });
+
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        for (FileRead& read : batch) {
+            const auto it = _reads.find(read.filepath);
+            if (it != _reads.end()) {
+                // needed again before the read completed
+                it->second.dropped = false;
+                continue;
+            }
+
+            _queue.push_back(read.filepath);
+            _reads.emplace(read.filepath, std::move(read));
+        }
+    }
+    _wake.notify_all();
+#endif
+}
+
+void BatchReader::Prioritize(const std::string& filepath) {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    const auto it = std::find(_queue.begin(), _queue.end(), filepath);
+    if (it == _queue.end())
+        return;
+
+    _queue.erase(it);
+    _queue.push_front(filepath);
+}
+
+void BatchReader::Retain(const std::unordered_set<std::string>& keep) {
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        _queue.erase(std::remove_if(_queue.begin(), _queue.end(),
+            [&keep](const std::string& filepath) { return keep.count(filepath) == 0; }),
+            _queue.end());
+
+        for (auto it = _reads.begin(); it != _reads.end();) {
+            FileRead& read = it->second;
+            if (keep.count(read.filepath) != 0) {
+                ++it;
+            } else if (read.state == ReadState::READING) {
+                read.dropped = true;
+                ++it;
+            } else {
+                BufferPool::Get().Free(read.buffer);
+                it = _reads.erase(it);
+            }
+        }
+    }
+    _done.notify_all();
+}
+
+void BatchReader::Clear() {
+    Retain({});
+}
+
+bool BatchReader::Take(const std::string& filepath,
+    const long modTime,
+    const bool waitQueued,
+    const std::function<bool()>& isCancelled,
+    MappedFile& file) {
+    std::unique_lock<std::mutex> lock{ _mutex };
+    while (true) {
+        const auto it = _reads.find(filepath);
+        if (it == _reads.end())
+            return false;
+
+        FileRead& read = it->second;
+        read.dropped = false;
+        if (read.state == ReadState::QUEUED && !waitQueued) {
+            // faster to read it now than to wait for the files before it
+            _queue.erase(std::find(_queue.begin(), _queue.end(), filepath));
+            _reads.erase(it);
+            return false;
+        }
+
+        if (read.state == ReadState::DONE || read.state == ReadState::FAILED) {
+            // modified since it was read
+            const bool valid = read.state == ReadState::DONE && read.modTime == modTime;
+            unsigned char* buffer = read.buffer;
+            const uint64_t size = read.size;
+            _reads.erase(it);
+            lock.unlock();
+
+            if (!valid) {
+                BufferPool::Get().Free(buffer);
+                return false;
+            }
+
+            file.Adopt(buffer, size);
+            return true;
+        }
+
+        if (isCancelled())
+            return false;
+
+        _done.wait_for(lock, std::chrono::milliseconds(10));
+    }
+}
+
+BatchReader::FileRead* BatchReader::PopQueued() {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    while (!_queue.empty()) {
+        const auto it = _reads.find(_queue.front());
+        _queue.pop_front();
+        if (it == _reads.end())
+            continue;
+
+        it->second.state = ReadState::READING;
+        return &it->second;
+    }
+
+    return nullptr;
+}
+
+void BatchReader::Complete(FileRead* read, const bool success) {
+#if !defined(_WIN32)
+    if (read->fd >= 0) {
+        close(read->fd);
+        read->fd = -1;
+    }
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        if (!success || read->dropped) {
+            BufferPool::Get().Free(read->buffer);
+            read->buffer = nullptr;
+        }
+
+        if (read->dropped) {
+            _reads.erase(read->filepath);
+        } else {
+            read->state = success ? ReadState::DONE : ReadState::FAILED;
+        }
+    }
+    _done.notify_all();
+}
+
+void BatchReader::ReadLoop() {
+#if !defined(_WIN32)
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock{ _mutex };
+            _wake.wait(lock, [this]() { return _stop || !_queue.empty(); });
+            if (_stop)
+                return;
+        }
+
+        FileRead* read = PopQueued();
+        if (read == nullptr)
+            continue;
+
+        read->buffer = static_cast<unsigned char*>(BufferPool::Get().Allocate(read->size));
+        read->fd = open(read->filepath.c_str(), O_RDONLY | O_CLOEXEC);
+        bool success = read->buffer != nullptr && read->fd >= 0;
+        while (success && read->done < read->size) {
+            const uint64_t size = std::min(_maxReadSize, read->size - read->done);
+            const ssize_t count = pread(read->fd, read->buffer + read->done, size,
+                static_cast<off_t>(read->done));
+            if (count < 0 && errno == EINTR)
+                continue;
+
+            // the file shrank since it was queued
+            success = count > 0;
+            read->done += count > 0 ? static_cast<uint64_t>(count) : 0;
+        }
+
+        Complete(read, success);
+    }
+#endif
+}
+
+void BatchReader::RingLoop() {
+#if defined(__linux__)
+    unsigned inFlight = 0;
+    while (true) {
+        bool stopping = false;
+        {
+            std::unique_lock<std::mutex> lock{ _mutex };
+            _wake.wait(lock, [this, inFlight]() { return _stop || !_queue.empty() || inFlight > 0; });
+            stopping = _stop;
+            if (stopping && inFlight == 0)
+                return;
+        }
+
+        // fill the ring with the next files, in order
+        FileRead* read = nullptr;
+        while (!stopping && inFlight < _ringEntries && (read = PopQueued()) != nullptr) {
+            read->buffer = static_cast<unsigned char*>(BufferPool::Get().Allocate(read->size));
+            read->fd = open(read->filepath.c_str(), O_RDONLY | O_CLOEXEC);
+            if (read->buffer == nullptr || read->fd < 0) {
+                Complete(read, false);
+                continue;
+            }
+
+            PrepareRead(_ring, read->fd, read->buffer, std::min(_maxReadSize, read->size), 0, read);
+            ++inFlight;
+        }
+
+        // eg: EBUSY until the completions are reaped, the reads that were
+        // not submitted are submitted with the next call
+        if (!SubmitAndWait(_ring, inFlight > 0 ? 1 : 0)) {
+            logger::warn("io_uring_enter failed (%d)", errno);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        // completions, the remaining parts of the files are read next
+        unsigned head = *_ring->cqHead;
+        while (head != __atomic_load_n(_ring->cqTail, __ATOMIC_ACQUIRE)) {
+            const io_uring_cqe& cqe = _ring->cqes[head & _ring->cqMask];
+            FileRead* done = reinterpret_cast<FileRead*>(cqe.user_data);
+            const int result = cqe.res;
+            ++head;
+            __atomic_store_n(_ring->cqHead, head, __ATOMIC_RELEASE);
+
+            if (result == -EINTR || result == -EAGAIN) {
+                PrepareRead(_ring, done->fd, done->buffer + done->done,
+                    std::min(_maxReadSize, done->size - done->done), done->done, done);
+                SubmitAndWait(_ring, 0);
+                continue;
+            }
+
+            done->done += result > 0 ? static_cast<uint64_t>(result) : 0;
+            if (result > 0 && done->done < done->size) {
+                PrepareRead(_ring, done->fd, done->buffer + done->done,
+                    std::min(_maxReadSize, done->size - done->done), done->done, done);
+                SubmitAndWait(_ring, 0);
+                continue;
+            }
+
+            // failed, or the file shrank since it was queued
+            Complete(done, result > 0);
+            --inFlight;
+        }
+    }
+#endif
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "mappedFile.hpp"
+
+
+// submission and completion rings of io_uring (see batchReader.cpp)
+struct IoUring;
+
+/**
+ * Reads the files of the prefetch window ahead of the decode workers. Each
+ * window is read as one batch ordered by inode (close to the order of the
+ * files on disk), instead of one blocking read per decode worker, so that a
+ * card reader or a spinning disk does not seek back and forth between them.
+ *
+ * On Linux the reads are submitted to io_uring (with the raw syscalls, there
+ * is no liburing), on the other POSIX systems and if io_uring is not
+ * available (old kernels, seccomp) a pool of threads reads the files with
+ * `pread`, in the same order. The files are read whole into buffers from
+ * `BufferPool`, and the decode workers take them with `Take`. On Windows
+ * nothing is read ahead, the decode workers read the files as they did
+ * before.
+ */
+class BatchReader {
+public:
+    /**
+     * @param `numThreads` - of the `pread` fallback
+     */
+    explicit BatchReader(const uint32_t numThreads = 2);
+    // waits for the reads in flight
+    ~BatchReader();
+
+    BatchReader(const BatchReader&) = delete;
+    BatchReader(BatchReader&&) = delete;
+    BatchReader& operator=(const BatchReader&) = delete;
+    BatchReader& operator=(BatchReader&&) = delete;
+
+    /**
+     * Queues reading the files as one batch (after the batches before it).
+     * Raw files (only their preview is decoded), files larger than
+     * `_maxFileSize` and files that are already queued are skipped.
+     */
+    void Submit(const std::vector<std::string>& filepaths);
+
+    // moves a queued file to the front of the queue
+    void Prioritize(const std::string& filepath);
+
+    // drops the files that are not in `keep` (the buffers of the reads in
+    // flight are freed when they complete)
+    void Retain(const std::unordered_set<std::string>& keep);
+
+    // drops all the files
+    void Clear();
+
+    /**
+     * Hands the contents of a file to a decode worker. Waits if the file is
+     * being read (or is queued and `waitQueued` is set).
+     *
+     * @param `modTime` - modification time of the file, the contents are
+     *                    dropped if the file was modified since it was read
+     * @param `isCancelled` - checked while waiting, stops waiting if true
+     * @param `file` - set to the contents
+     * @returns false if the file was not submitted, could not be read, or
+     *          is still queued (it is dropped from the queue then)
+     */
+    bool Take(const std::string& filepath,
+        const long modTime,
+        const bool waitQueued,
+        const std::function<bool()>& isCancelled,
+        MappedFile& file);
+
+    [[nodiscard]] inline bool UsesIoUring() const { return _ring != nullptr; }
+
+private:
+    enum class ReadState {
+        QUEUED,
+        READING,
+        DONE,
+        FAILED,
+    };
+
+    struct FileRead {
+        std::string filepath;
+        uint64_t inode = 0;
+        uint64_t size = 0;
+        long modTime = 0;
+        ReadState state = ReadState::QUEUED;
+        unsigned char* buffer = nullptr; // from `BufferPool`
+        uint64_t done = 0; // bytes read
+        int fd = -1;
+        bool dropped = false; // free it when the read completes
+    };
+
+    // pops the next queued file and marks it as being read, nullptr if none
+    FileRead* PopQueued();
+    // marks a read as done or failed and wakes the waiting workers
+    void Complete(FileRead* read, const bool success);
+
+    // pread fallback, runs on `_threads`
+    void ReadLoop();
+    // io_uring backend, runs on `_threads[0]`
+    void RingLoop();
+
+private:
+    // files are read in requests of at most this many bytes
+    constexpr static uint64_t _maxReadSize = 8 * 1024 * 1024;
+    constexpr static uint64_t _maxFileSize = 64 * 1024 * 1024;
+    constexpr static unsigned _ringEntries = 16;
+
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _wake; // for the readers
+    std::condition_variable _done; // for `Take`
+    // the nodes do not move, the reads in flight point to them
+    std::unordered_map<std::string, FileRead> _reads;
+    std::deque<std::string> _queue; // not read yet, in order
+    bool _stop = false;
+
+    IoUring* _ring = nullptr; // only used on `_threads[0]`
+};
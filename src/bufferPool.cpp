@@ -0,0 +1,127 @@
+#include "bufferPool.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+
+BufferPool& BufferPool::Get() {
+    static BufferPool pool;
+    return pool;
+}
+
+BufferPool::~BufferPool() {
+    Trim();
+}
+
+void* BufferPool::Allocate(const size_t size) {
+    const size_t classSize = GetClassSize(size);
+    if (classSize == 0)
+        return malloc(size);
+
+    std::lock_guard<std::mutex> lock{ _mutex };
+    void* ptr = nullptr;
+    auto idle = _idle.find(classSize);
+    if (idle != _idle.end() && !idle->second.empty()) {
+        ptr = idle->second.back();
+        idle->second.pop_back();
+        _stats.idleBytes -= classSize;
+        ++_stats.hits;
+    } else {
+        ptr = malloc(classSize);
+        if (ptr == nullptr)
+            return nullptr;
+        ++_stats.misses;
+    }
+
+    // the address can still be in there if it was freed with `free`
+    _used[ptr] = classSize;
+    _stats.usedBytes += classSize;
+    _stats.peakBytes = std::max(_stats.peakBytes, _stats.usedBytes + _stats.idleBytes);
+    return ptr;
+}
+
+void* BufferPool::Reallocate(void* ptr, const size_t oldSize, const size_t newSize) {
+    if (ptr == nullptr)
+        return Allocate(newSize);
+
+    size_t capacity = 0;
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        const auto it = _used.find(ptr);
+        if (it != _used.end()) {
+            capacity = it->second;
+        }
+    }
+
+    // (the contents cannot be copied to the pool without their size)
+    if (capacity == 0 && (oldSize == 0 || GetClassSize(newSize) == 0))
+        return realloc(ptr, newSize);
+    if (capacity >= newSize)
+        return ptr;
+
+    void* data = Allocate(newSize);
+    if (data == nullptr)
+        return nullptr;
+
+    std::memcpy(data, ptr, std::min(capacity > 0 ? capacity : oldSize, newSize));
+    Free(ptr);
+    return data;
+}
+
+void BufferPool::Free(void* ptr) {
+    if (ptr == nullptr)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        const auto it = _used.find(ptr);
+        if (it != _used.end()) {
+            const size_t classSize = it->second;
+            _used.erase(it);
+            _stats.usedBytes -= classSize;
+            if (_stats.idleBytes + classSize <= _maxIdleBytes) {
+                _idle[classSize].push_back(ptr);
+                _stats.idleBytes += classSize;
+                return;
+            }
+        }
+    }
+
+    free(ptr);
+}
+
+void BufferPool::FreeImage(Image& image) {
+    Free(image.data);
+    image = Image{};
+}
+
+void BufferPool::Trim() {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    for (auto& [classSize, buffers] : _idle) {
+        for (void* ptr : buffers) {
+            free(ptr);
+        }
+    }
+
+    _idle.clear();
+    _stats.idleBytes = 0;
+}
+
+BufferPoolStats BufferPool::GetStats() const {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    return _stats;
+}
+
+size_t BufferPool::GetClassSize(const size_t size) {
+    if (size < _minPooledSize)
+        return 0;
+
+    // rounded up to a multiple of 1/8 of the largest power of two below it
+    size_t power = _minPooledSize;
+    while (power <= size / 2) {
+        power *= 2;
+    }
+    const size_t step = power / _classesPerDoubling;
+    return (size + step - 1) / step * step;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include "raylib.h"
+
+
+struct BufferPoolStats {
+    uint64_t usedBytes = 0; // handed out (rounded up to the size classes)
+    uint64_t idleBytes = 0; // freed and kept to be reused
+    uint64_t peakBytes = 0; // max of used + idle
+    uint64_t hits = 0; // allocations that reused an idle buffer
+    uint64_t misses = 0;
+};
+
+/**
+ * Pool of the large buffers of the decoders: the file contents, the pixels
+ * decoded by stb_image (through `STBI_MALLOC`/`STBI_FREE`, see
+ * `stbImage.cpp`), the downscaled images and their mipmaps. Freed buffers
+ * are kept per size class (8 per power of two, so at most 12.5% larger than
+ * requested) and reused, instead of allocating and freeing tens of MB per
+ * image, which fragments the heap over a long session.
+ *
+ * Small allocations go straight to `malloc`. The pooled buffers have to be
+ * freed with `BufferPool::Free` (or `FreeImage`), never with `free` (eg:
+ * raylib's `UnloadImage`): the pool would still count the address as in use,
+ * and if `malloc` returns it again for a smaller buffer, freeing that one
+ * would put it in the pool with the old class size (and the next user of it
+ * would overflow the heap). Thread safe, shared by the whole process.
+ */
+class BufferPool {
+public:
+    static BufferPool& Get();
+
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool(BufferPool&&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    BufferPool& operator=(BufferPool&&) = delete;
+
+    // @returns nullptr if the allocation failed
+    void* Allocate(const size_t size);
+
+    /**
+     * Same as `realloc`, the buffer is kept if it is already large enough
+     * @param `oldSize` - bytes of `ptr` to keep (not needed for pooled buffers),
+     *                    0 if unknown: a buffer that is not pooled is then
+     *                    grown with `realloc` and stays out of the pool
+     */
+    void* Reallocate(void* ptr, const size_t oldSize, const size_t newSize);
+
+    // `ptr` can be nullptr, a buffer of the pool or one allocated with `malloc`
+    void Free(void* ptr);
+
+    // frees the pixels of a decoded image and resets it
+    void FreeImage(Image& image);
+
+    // frees the idle buffers
+    void Trim();
+
+    [[nodiscard]] BufferPoolStats GetStats() const;
+
+private:
+    BufferPool() = default;
+
+    // size of the class that `size` is rounded up to, 0 if it is not pooled
+    static size_t GetClassSize(const size_t size);
+
+private:
+    constexpr static size_t _minPooledSize = 64 * 1024;
+    constexpr static int _classesPerDoubling = 8;
+    // more idle buffers than this are freed instead of being kept
+    constexpr static uint64_t _maxIdleBytes = 256ull * 1024 * 1024;
+
+    mutable std::mutex _mutex;
+    std::unordered_map<void*, size_t> _used; // pooled buffer -> class size
+    std::unordered_map<size_t, std::vector<void*>> _idle; // by class size
+    BufferPoolStats _stats{};
+};
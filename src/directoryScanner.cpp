@@ -0,0 +1,162 @@
+#include "directoryScanner.hpp"
+
+#include <cstring>
+#include <cctype>
+
+#if defined(_WIN32)
+    #include <filesystem>
+#else
+    #include <dirent.h>
+    #include <sys/stat.h>
+#endif
+
+
+namespace {
+
+// case-insensitive, `lowerExt` is lower-case
+bool ExtensionEquals(const char* ext, const char* lowerExt) {
+    for (; *ext && *lowerExt; ++ext, ++lowerExt) {
+        if (std::tolower(static_cast<unsigned char>(*ext)) != *lowerExt)
+            return false;
+    }
+
+    return *ext == *lowerExt;
+}
+
+// same as raylib's `GetFileExtension`, which is not used here so that the
+// scanner does not depend on raylib
+const char* FindExtension(const char* filename) {
+    const char* dot = strrchr(filename, '.');
+    if (dot == nullptr || dot == filename)
+        return nullptr;
+
+    return dot;
+}
+
+} // namespace
+
+
+namespace utils {
+
+bool HasImageExtension(const char* filename) {
+    constexpr const char* imageExtensions[] = { ".png", ".jpg", ".jpeg" };
+
+    const char* ext = FindExtension(filename);
+    if (ext == nullptr)
+        return false;
+
+    for (const char* imageExt : imageExtensions) {
+        if (ExtensionEquals(ext, imageExt))
+            return true;
+    }
+
+    return HasRawExtension(filename);
+}
+
+bool HasRawExtension(const char* filename) {
+    // raw formats that are TIFF based, so the embedded JPEG preview can be
+    // found by walking the IFDs
+    constexpr const char* rawExtensions[] = {
+        ".arw", ".sr2", ".srf", ".nef", ".nrw", ".cr2", ".dng",
+        ".pef", ".orf", ".rw2", ".erf", ".3fr", ".dcr", ".kdc",
+    };
+
+    const char* ext = FindExtension(filename);
+    if (ext == nullptr)
+        return false;
+
+    for (const char* rawExt : rawExtensions) {
+        if (ExtensionEquals(ext, rawExt))
+            return true;
+    }
+
+    return false;
+}
+
+bool HasSidecarExtension(const char* filename) {
+    const char* ext = FindExtension(filename);
+    return ext != nullptr && ExtensionEquals(ext, ".xmp");
+}
+
+ScanStats ScanDirectory(const std::string& directory,
+    const std::function<bool(const std::string&)>& onImage,
+    const std::function<void(const std::string&)>& onOther) {
+    ScanStats stats{};
+
+#if defined(_WIN32)
+    // the file attributes come with `FindNextFile`, so `directory_entry`
+    // answers `is_regular_file` without another syscall
+    std::error_code err;
+    for (const auto& entry : std::filesystem::directory_iterator{ directory, err }) {
+        ++stats.entries;
+        // in windows path().c_str() gives wide char
+        const std::string filepath = entry.path().string();
+        const std::string filename = entry.path().filename().string();
+        if (filename[0] == '.')
+            continue;
+        const bool isImage = HasImageExtension(filename.c_str());
+        if (!isImage && !onOther)
+            continue;
+
+        if (!entry.is_regular_file(err))
+            continue;
+
+        if (!isImage) {
+            onOther(filepath);
+            continue;
+        }
+
+        ++stats.images;
+        if (!onImage(filepath))
+            break;
+    }
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr)
+        return stats;
+
+    std::string filepath = directory;
+    if (!filepath.empty() && filepath.back() != '/')
+        filepath += '/';
+    const size_t dirLength = filepath.size();
+
+    while (const dirent* entry = readdir(dir)) {
+        ++stats.entries;
+        // also skips "." and ".."
+        if (entry->d_name[0] == '.')
+            continue;
+        const bool isImage = HasImageExtension(entry->d_name);
+        if (!isImage && !onOther)
+            continue;
+
+        filepath.resize(dirLength);
+        filepath += entry->d_name;
+
+        if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) {
+            // the file system does not report the type (or it is a symlink,
+            // which is followed)
+            ++stats.statCalls;
+            struct stat fileStat{};
+            if (stat(filepath.c_str(), &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+                continue;
+        } else if (entry->d_type != DT_REG) {
+            continue;
+        }
+
+        if (!isImage) {
+            onOther(filepath);
+            continue;
+        }
+
+        ++stats.images;
+        if (!onImage(filepath))
+            break;
+    }
+
+    closedir(dir);
+#endif
+
+    return stats;
+}
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <functional>
+
+
+struct ScanStats {
+    uint64_t entries = 0; // directory entries read
+    uint64_t images = 0; // entries that passed the filters
+    uint64_t statCalls = 0; // entries whose type was not known from the directory entry
+};
+
+namespace utils {
+
+// check if the file name has a png/jpg or a raw extension
+// (case-insensitive, does not access the file)
+bool HasImageExtension(const char* filename);
+
+// check if the file name has the extension of a TIFF based raw format
+// (case-insensitive, does not access the file)
+bool HasRawExtension(const char* filename);
+
+// check if the file name has the extension of a sidecar file (eg: ".xmp")
+// (case-insensitive, does not access the file)
+bool HasSidecarExtension(const char* filename);
+
+/**
+ * Lists the images of a directory (not recursive) in a single pass. The
+ * entries are filtered by their extension first, the file type comes from
+ * the directory entry (`d_type`) so a regular file costs no syscall; `stat`
+ * is only called for the images on file systems that do not report the type
+ * and for symlinks. Hidden files (eg: "._IMG_0001.JPG") are skipped.
+ *
+ * @param `directory` - path of the directory
+ * @param `onImage` - called with the path of each image, in directory order,
+ *                    return false to stop the scan
+ * @param `onOther` - if set, called with the path of the other regular files
+ *                    (eg: sidecar files, for `PairingIndex`) in the same pass
+ * @returns counters of the scan
+ */
+ScanStats ScanDirectory(const std::string& directory,
+    const std::function<bool(const std::string&)>& onImage,
+    const std::function<void(const std::string&)>& onOther = nullptr);
+
+}
@@ -0,0 +1,119 @@
+#include "directoryStream.hpp"
+
+#include <chrono>
+#include <filesystem>
+
+
+DirectoryStream::~DirectoryStream() {
+    Close();
+}
+
+void DirectoryStream::Open(const std::string& directory,
+    const std::string& rawDirectory,
+    const std::string& rawExt) {
+    Close();
+    _thread = std::thread(&DirectoryStream::ScanLoop, this, directory, rawDirectory, rawExt);
+}
+
+void DirectoryStream::Close() {
+    if (_thread.joinable()) {
+        _stop = true;
+        _thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock{ _mutex };
+    _found.Clear();
+    _stats = ScanStats{};
+    _pairing.Clear("");
+    _finished = false;
+    _stop = false;
+}
+
+bool DirectoryStream::Poll(ImageList& batch) {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    if (_found.Empty())
+        return false;
+
+    batch.Append(_found);
+    _found.Clear();
+    return true;
+}
+
+bool DirectoryStream::IsDone() const {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    return _finished && _found.Empty();
+}
+
+ScanStats DirectoryStream::GetStats() const {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    return _stats;
+}
+
+PairingIndex DirectoryStream::TakePairingIndex() {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    return std::move(_pairing);
+}
+
+void DirectoryStream::ScanLoop(const std::string directory,
+    const std::string rawDirectory,
+    const std::string rawExt) {
+    using Clock = std::chrono::steady_clock;
+
+    ImageList batch;
+    bool first = true;
+    auto lastHandOver = Clock::now();
+
+    const auto handOver = [&]() {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        _found.Append(batch);
+        batch.Clear();
+        lastHandOver = Clock::now();
+    };
+
+    PairingIndex pairing;
+    pairing.Clear(rawExt);
+    const auto addToPairing = [&pairing](const std::string& filepath) { pairing.Add(filepath); };
+
+    const ScanStats stats = utils::ScanDirectory(directory,
+        [&](const std::string& filepath) {
+            if (_stop)
+                return false;
+
+            batch.PushBack(filepath);
+            pairing.Add(filepath);
+
+            const double elapsed =
+                std::chrono::duration<double>(Clock::now() - lastHandOver).count();
+            if (first || batch.Size() >= _batchSize || elapsed >= _batchInterval) {
+                first = false;
+                handOver();
+            }
+            return true;
+        },
+        addToPairing);
+
+    handOver();
+
+    // the raw images can be kept in another directory
+    std::error_code err;
+    if (!_stop && !rawDirectory.empty()
+            && !std::filesystem::equivalent(directory, rawDirectory, err) && !err) {
+        utils::ScanDirectory(rawDirectory,
+            [&](const std::string& filepath) {
+                if (_stop)
+                    return false;
+
+                // only the raw files go with the images
+                if (utils::HasRawExtension(filepath.c_str())) {
+                    pairing.Add(filepath);
+                }
+                return true;
+            },
+            addToPairing);
+    }
+
+    std::lock_guard<std::mutex> lock{ _mutex };
+    _stats = stats;
+    _pairing = std::move(pairing);
+    _finished = true;
+}
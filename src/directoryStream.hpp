@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include "imageList.hpp"
+#include "directoryScanner.hpp"
+#include "pairingIndex.hpp"
+
+
+/**
+ * Lists the images of a directory on a background thread (using
+ * `utils::ScanDirectory`) and hands them to the main thread in batches, so
+ * that the first image can be shown before the whole directory is listed.
+ * The `PairingIndex` of the directory (and of the raw image directory) is
+ * built in the same pass.
+ */
+class DirectoryStream {
+public:
+    DirectoryStream() = default;
+    ~DirectoryStream();
+
+    DirectoryStream(const DirectoryStream&) = delete;
+    DirectoryStream(DirectoryStream&&) = delete;
+    DirectoryStream& operator=(const DirectoryStream&) = delete;
+    DirectoryStream& operator=(DirectoryStream&&) = delete;
+
+    /**
+     * Starts listing the directory, the previous scan is stopped first
+     * @param `directory` - path of the directory
+     * @param `rawDirectory` - path of the raw image directory, its raw and
+     *                         sidecar files are only added to the pairing index
+     * @param `rawExt` - raw extension of the config (see `PairingIndex::Clear`)
+     */
+    void Open(const std::string& directory,
+        const std::string& rawDirectory,
+        const std::string& rawExt);
+
+    // stops the scan and drops the images that were not polled yet
+    void Close();
+
+    /**
+     * Moves the images found since the last call to the end of `batch`.
+     * Does not block.
+     * @returns false if there were no new images
+     */
+    bool Poll(ImageList& batch);
+
+    /**
+     * @returns true if a scan was started, it has finished and all of its
+     *          images were polled
+     */
+    [[nodiscard]] bool IsDone() const;
+
+    [[nodiscard]] inline bool IsOpen() const { return _thread.joinable(); }
+
+    // counters of the finished scan
+    [[nodiscard]] ScanStats GetStats() const;
+
+    // moves out the pairing index of the finished scan
+    [[nodiscard]] PairingIndex TakePairingIndex();
+
+private:
+    // runs on `_thread`
+    void ScanLoop(const std::string directory,
+        const std::string rawDirectory,
+        const std::string rawExt);
+
+private:
+    // images handed over at once, the first image is handed over on its own
+    constexpr static size_t _batchSize = 256;
+    // a partial batch is handed over after this long (in seconds),
+    // for directories that are slow to list (eg: network mounts)
+    constexpr static double _batchInterval = 0.02;
+
+    std::thread _thread;
+    mutable std::mutex _mutex;
+    ImageList _found; // not polled yet
+    ScanStats _stats{};
+    PairingIndex _pairing; // of the finished scan
+    bool _finished = false;
+    std::atomic<bool> _stop = false;
+};
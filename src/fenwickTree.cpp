@@ -0,0 +1,67 @@
+#include "fenwickTree.hpp"
+
+
+namespace {
+
+inline size_t LowBit(const size_t i) {
+    return i & (~i + 1);
+}
+
+} // namespace
+
+
+void FenwickTree::Assign(const std::vector<uint32_t>& values) {
+    _tree.assign(values.begin(), values.end());
+    for (size_t i = 1; i <= _tree.size(); ++i) {
+        const size_t parent = i + LowBit(i);
+        if (parent <= _tree.size()) {
+            _tree[parent - 1] += _tree[i - 1];
+        }
+    }
+}
+
+void FenwickTree::Clear() {
+    _tree.clear();
+}
+
+void FenwickTree::PushBack(const uint32_t value) {
+    // the new node covers (i - lowbit(i), i], the elements before it in that
+    // range are already in the tree
+    const size_t i = _tree.size() + 1;
+    _tree.push_back(static_cast<uint32_t>(value + PrefixSum(i - 1) - PrefixSum(i - LowBit(i))));
+}
+
+void FenwickTree::Add(const size_t idx, const int64_t delta) {
+    for (size_t i = idx + 1; i <= _tree.size(); i += LowBit(i)) {
+        _tree[i - 1] = static_cast<uint32_t>(static_cast<int64_t>(_tree[i - 1]) + delta);
+    }
+}
+
+uint64_t FenwickTree::PrefixSum(size_t count) const {
+    uint64_t sum = 0;
+    for (; count > 0; count -= LowBit(count)) {
+        sum += _tree[count - 1];
+    }
+
+    return sum;
+}
+
+size_t FenwickTree::Find(uint64_t sum) const {
+    size_t step = 1;
+    while (step * 2 <= _tree.size()) {
+        step *= 2;
+    }
+
+    // descend from the largest power of two, `pos` ends up as the number of
+    // elements whose prefix sum is not greater than `sum`
+    size_t pos = 0;
+    for (; step > 0; step /= 2) {
+        const size_t next = pos + step;
+        if (next <= _tree.size() && _tree[next - 1] <= sum) {
+            pos = next;
+            sum -= _tree[next - 1];
+        }
+    }
+
+    return pos;
+}
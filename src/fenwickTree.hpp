@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * Binary indexed tree of non-negative counts: updates, prefix sums and
+ * finding the element with a given prefix sum in O(log n). The total must
+ * fit in 32 bits.
+ */
+class FenwickTree {
+public:
+    FenwickTree() = default;
+
+    // rebuilds the tree from `values` in O(n)
+    void Assign(const std::vector<uint32_t>& values);
+
+    void Clear();
+
+    // adds an element at the end
+    void PushBack(const uint32_t value);
+
+    void Add(const size_t idx, const int64_t delta);
+
+    // sum of the first `count` elements
+    [[nodiscard]] uint64_t PrefixSum(size_t count) const;
+
+    /**
+     * @returns index of the element at which the prefix sum exceeds `sum`
+     *          (eg: the index of the `sum`-th non-zero element when all the
+     *          values are 0 or 1), `Size()` if the total is not greater
+     */
+    [[nodiscard]] size_t Find(uint64_t sum) const;
+
+    [[nodiscard]] inline size_t Size() const { return _tree.size(); }
+    [[nodiscard]] inline uint64_t Total() const { return PrefixSum(_tree.size()); }
+
+private:
+    // `_tree[i - 1]` holds the sum of the elements (i - lowbit(i), i],
+    // 32 bit to keep it small (the sums are at most the number of elements)
+    std::vector<uint32_t> _tree;
+};
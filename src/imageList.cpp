@@ -0,0 +1,255 @@
+#include "imageList.hpp"
+
+#include <cstring>
+#include "directoryScanner.hpp"
+
+
+void ImageList::Clear() {
+    _arena.clear();
+    _unusedArenaBytes = 0;
+    _unusedEXIF = 0;
+
+    _pathOffsets.clear();
+    _nameOffsets.clear();
+    _extOffsets.clear();
+    _flags.clear();
+    _exifIndices.clear();
+    _captureTimes.clear();
+    _live.Clear();
+    _exif.clear();
+}
+
+void ImageList::Reserve(const size_t count, const size_t pathBytes) {
+    _arena.reserve(pathBytes + count);
+    _pathOffsets.reserve(count);
+    _nameOffsets.reserve(count);
+    _extOffsets.reserve(count);
+    _flags.reserve(count);
+    _exifIndices.reserve(count);
+    _captureTimes.reserve(count);
+}
+
+void ImageList::PushBack(const std::string_view filepath) {
+    // the offsets in the path are 16 bit (paths are at most 4096 bytes)
+    if (filepath.empty() || filepath.size() > UINT16_MAX)
+        return;
+
+    const size_t nameStart = filepath.find_last_of("\\/");
+    const uint16_t nameOffset =
+        static_cast<uint16_t>(nameStart == std::string_view::npos ? 0 : nameStart + 1);
+
+    // same as raylib's `GetFileExtension` on the filename
+    const size_t dot = filepath.find_last_of('.');
+    const uint16_t extOffset = dot != std::string_view::npos && dot > nameOffset
+        ? static_cast<uint16_t>(dot)
+        : static_cast<uint16_t>(filepath.size());
+
+    _pathOffsets.push_back(static_cast<uint32_t>(_arena.size()));
+    _arena.insert(_arena.end(), filepath.begin(), filepath.end());
+    _arena.push_back('\0');
+
+    _nameOffsets.push_back(nameOffset);
+    _extOffsets.push_back(extOffset);
+    _flags.push_back(utils::HasRawExtension(_arena.data() + _pathOffsets.back()) ? FLAG_RAW : 0);
+    _exifIndices.push_back(_noEXIF);
+    _captureTimes.push_back(0);
+    _live.PushBack(1);
+}
+
+void ImageList::Append(const ImageList& other) {
+    const uint32_t arenaOffset = static_cast<uint32_t>(_arena.size());
+    _arena.insert(_arena.end(), other._arena.begin(), other._arena.end());
+    _unusedArenaBytes += other._unusedArenaBytes;
+
+    for (const uint32_t offset : other._pathOffsets) {
+        _pathOffsets.push_back(arenaOffset + offset);
+    }
+    for (const uint32_t exifIdx : other._exifIndices) {
+        _exifIndices.push_back(exifIdx == _noEXIF
+            ? _noEXIF
+            : static_cast<uint32_t>(_exif.size() + exifIdx));
+    }
+    _exif.insert(_exif.end(), other._exif.begin(), other._exif.end());
+    _unusedEXIF += other._unusedEXIF;
+
+    _nameOffsets.insert(_nameOffsets.end(), other._nameOffsets.begin(), other._nameOffsets.end());
+    _extOffsets.insert(_extOffsets.end(), other._extOffsets.begin(), other._extOffsets.end());
+    _flags.insert(_flags.end(), other._flags.begin(), other._flags.end());
+    _captureTimes.insert(_captureTimes.end(), other._captureTimes.begin(), other._captureTimes.end());
+    for (const uint8_t flags : other._flags) {
+        _live.PushBack((flags & FLAG_DELETED) != 0 ? 0 : 1);
+    }
+}
+
+void ImageList::MarkDeleted(const size_t idx) {
+    if (IsDeleted(idx))
+        return;
+
+    _flags[idx] |= FLAG_DELETED;
+    _live.Add(idx, -1);
+}
+
+void ImageList::Restore(const size_t idx) {
+    if (!IsDeleted(idx))
+        return;
+
+    _flags[idx] &= static_cast<uint8_t>(~FLAG_DELETED);
+    _live.Add(idx, 1);
+}
+
+void ImageList::RemoveDeleted() {
+    if (DeletedCount() == 0)
+        return;
+
+    RemoveIf([this](const size_t idx) { return IsDeleted(idx); });
+}
+
+const tinyexif::EXIFRecord* ImageList::GetEXIF(const size_t idx) const {
+    const uint32_t exifIdx = _exifIndices[idx];
+    return exifIdx == _noEXIF ? nullptr : &_exif[exifIdx];
+}
+
+void ImageList::SetEXIF(const size_t idx, const tinyexif::EXIFRecord& exif) {
+    uint32_t& exifIdx = _exifIndices[idx];
+    if (exifIdx == _noEXIF) {
+        exifIdx = static_cast<uint32_t>(_exif.size());
+        _exif.push_back(exif);
+    } else {
+        _exif[exifIdx] = exif;
+    }
+}
+
+ImageDetails ImageList::GetDetails(const size_t idx) const {
+    ImageDetails details{};
+    details.filepath = GetPath(idx);
+    details.filename = GetFilename(idx);
+    details.extension = GetExtension(idx);
+    if (const tinyexif::EXIFRecord* exif = GetEXIF(idx)) {
+        details.exif = *exif;
+    }
+
+    return details;
+}
+
+size_t ImageList::Find(const std::string_view filepath) const {
+    for (size_t i = 0; i < Size(); ++i) {
+        if (filepath == GetPath(i))
+            return i;
+    }
+
+    return Size();
+}
+
+size_t ImageList::GetMemoryUsage() const {
+    return _arena.capacity()
+        + _pathOffsets.capacity() * sizeof(uint32_t)
+        + _nameOffsets.capacity() * sizeof(uint16_t)
+        + _extOffsets.capacity() * sizeof(uint16_t)
+        + _flags.capacity() * sizeof(uint8_t)
+        + _exifIndices.capacity() * sizeof(uint32_t)
+        + _captureTimes.capacity() * sizeof(uint64_t)
+        + _live.Size() * sizeof(uint32_t)
+        + _exif.capacity() * sizeof(tinyexif::EXIFRecord);
+}
+
+uint64_t ImageList::PackCaptureTime(const tinyexif::EXIFRecord& exif) {
+    const bool hasOriginal = exif.DateTimeOriginal.Length > 0;
+    const tinyexif::EXIFStringRef dateTime = hasOriginal ? exif.DateTimeOriginal : exif.DateTime;
+
+    // "YYYY:MM:DD HH:MM:SS"
+    uint64_t packed = 0;
+    int digits = 0;
+    for (uint16_t i = 0; i < dateTime.Length && digits < 14; ++i) {
+        const char ch = exif.Arena[dateTime.Offset + i];
+        if (ch >= '0' && ch <= '9') {
+            packed = packed * 10 + static_cast<uint64_t>(ch - '0');
+            ++digits;
+        }
+    }
+    if (digits != 14 || packed == 0)
+        return 0;
+
+    // milliseconds, "5" is 500 ms
+    uint64_t millis = 0;
+    int subSecDigits = 0;
+    const tinyexif::EXIFStringRef subSec = exif.SubSecTimeOriginal;
+    for (uint16_t i = 0; hasOriginal && i < subSec.Length && subSecDigits < 3; ++i) {
+        const char ch = exif.Arena[subSec.Offset + i];
+        if (ch < '0' || ch > '9')
+            break;
+
+        millis = millis * 10 + static_cast<uint64_t>(ch - '0');
+        ++subSecDigits;
+    }
+    for (; subSecDigits < 3; ++subSecDigits) {
+        millis *= 10;
+    }
+
+    return packed * 1000 + millis;
+}
+
+void ImageList::Reorder(const std::vector<uint32_t>& order) {
+    const auto permute = [&order](auto& values) {
+        std::remove_reference_t<decltype(values)> permuted;
+        permuted.reserve(order.size());
+        for (const uint32_t idx : order) {
+            permuted.push_back(values[idx]);
+        }
+        values = std::move(permuted);
+    };
+
+    // paths and EXIF data of the images that are not kept
+    if (order.size() < Size()) {
+        std::vector<bool> kept(Size(), false);
+        for (const uint32_t idx : order) {
+            kept[idx] = true;
+        }
+        for (size_t i = 0; i < Size(); ++i) {
+            if (kept[i])
+                continue;
+
+            _unusedArenaBytes += std::strlen(GetPath(i)) + 1;
+            _unusedEXIF += _exifIndices[i] != _noEXIF ? 1 : 0;
+        }
+    }
+
+    permute(_pathOffsets);
+    permute(_nameOffsets);
+    permute(_extOffsets);
+    permute(_flags);
+    permute(_exifIndices);
+    permute(_captureTimes);
+
+    std::vector<uint32_t> live(_flags.size());
+    for (size_t i = 0; i < _flags.size(); ++i) {
+        live[i] = (_flags[i] & FLAG_DELETED) != 0 ? 0 : 1;
+    }
+    _live.Assign(live);
+
+    if (_unusedArenaBytes > _arena.size() / 2 || _unusedEXIF > _exif.size() / 2) {
+        Compact();
+    }
+}
+
+void ImageList::Compact() {
+    std::vector<char> arena;
+    arena.reserve(_arena.size() - _unusedArenaBytes);
+    std::vector<tinyexif::EXIFRecord> exif;
+    exif.reserve(_exif.size() - _unusedEXIF);
+
+    for (size_t i = 0; i < Size(); ++i) {
+        const char* path = GetPath(i);
+        _pathOffsets[i] = static_cast<uint32_t>(arena.size());
+        arena.insert(arena.end(), path, path + std::strlen(path) + 1);
+
+        if (_exifIndices[i] != _noEXIF) {
+            exif.push_back(_exif[_exifIndices[i]]);
+            _exifIndices[i] = static_cast<uint32_t>(exif.size() - 1);
+        }
+    }
+
+    _arena = std::move(arena);
+    _exif = std::move(exif);
+    _unusedArenaBytes = 0;
+    _unusedEXIF = 0;
+}
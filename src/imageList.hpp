@@ -0,0 +1,251 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include "tinyexif/exif.h"
+#include "types.hpp"
+#include "fenwickTree.hpp"
+
+
+/**
+ * List of images stored as a structure of arrays. The paths are kept in one
+ * arena (null terminated) and each image is an index into parallel arrays of
+ * offsets, flags and packed metadata (about 25 bytes per image plus its
+ * path). The EXIF data of the images that have been loaded is kept in a side
+ * table of PODs.
+ *
+ * Sorting and removing images only moves the parallel arrays, the paths stay
+ * where they are in the arena (it is compacted once more than half of it is
+ * unused). Does not depend on raylib, so it can be filled on a background
+ * thread.
+ *
+ * Deleting an image only marks it as deleted (O(log n)), the indices of the
+ * other images stay valid. A Fenwick tree over the images that are not
+ * deleted gives the rank of an image and the next/previous image in O(log n);
+ * `RemoveDeleted` drops the deleted images.
+ */
+class ImageList {
+public:
+    ImageList() = default;
+
+    void Clear();
+
+    /**
+     * @param `count` - number of images
+     * @param `pathBytes` - total length of their paths
+     */
+    void Reserve(const size_t count, const size_t pathBytes);
+
+    /**
+     * Adds an image at the end of the list
+     * @param `filepath` - path of the image file
+     */
+    void PushBack(const std::string_view filepath);
+
+    // adds the images of `other` at the end of the list
+    void Append(const ImageList& other);
+
+    // number of images, including the deleted ones
+    [[nodiscard]] inline size_t Size() const { return _pathOffsets.size(); }
+    // check if there are no images that are not deleted
+    [[nodiscard]] inline bool Empty() const { return LiveCount() == 0; }
+
+    // number of images that are not deleted
+    [[nodiscard]] inline size_t LiveCount() const { return static_cast<size_t>(_live.Total()); }
+    [[nodiscard]] inline size_t DeletedCount() const { return Size() - LiveCount(); }
+
+    [[nodiscard]] inline bool IsDeleted(const size_t idx) const {
+        return (_flags[idx] & FLAG_DELETED) != 0;
+    }
+
+    // marks the image as deleted, its index stays valid until `RemoveDeleted`
+    void MarkDeleted(const size_t idx);
+    // undoes `MarkDeleted`
+    void Restore(const size_t idx);
+    // drops the deleted images (linear), the indices of the others change
+    void RemoveDeleted();
+
+    // number of images before `idx` that are not deleted
+    [[nodiscard]] inline size_t LiveRank(const size_t idx) const {
+        return static_cast<size_t>(_live.PrefixSum(idx));
+    }
+
+    /**
+     * @param `rank` - see `LiveRank`
+     * @returns index of the image that is not deleted with that rank,
+     *          `Size()` if there is none
+     */
+    [[nodiscard]] inline size_t NthLive(const size_t rank) const {
+        return _live.Find(rank);
+    }
+
+    /**
+     * @returns index of the next image after `idx` that is not deleted,
+     *          `Size()` if there is none
+     */
+    [[nodiscard]] inline size_t NextLive(const size_t idx) const {
+        return NthLive(static_cast<size_t>(_live.PrefixSum(idx + 1)));
+    }
+
+    /**
+     * @returns index of the previous image before `idx` that is not deleted,
+     *          `Size()` if there is none
+     */
+    [[nodiscard]] inline size_t PrevLive(const size_t idx) const {
+        const size_t rank = LiveRank(idx);
+        return rank > 0 ? NthLive(rank - 1) : Size();
+    }
+
+    // full path of the file
+    [[nodiscard]] inline const char* GetPath(const size_t idx) const {
+        return _arena.data() + _pathOffsets[idx];
+    }
+
+    // filename with extension
+    [[nodiscard]] inline const char* GetFilename(const size_t idx) const {
+        return GetPath(idx) + _nameOffsets[idx];
+    }
+
+    // extension of the file as it is in the path (eg: ".JPG"), "" if none
+    [[nodiscard]] inline const char* GetExtension(const size_t idx) const {
+        return GetPath(idx) + _extOffsets[idx];
+    }
+
+    // path without the extension
+    [[nodiscard]] inline std::string_view GetStem(const size_t idx) const {
+        return std::string_view{ GetPath(idx), _extOffsets[idx] };
+    }
+
+    // filename without the extension
+    [[nodiscard]] inline std::string_view GetFilenameNoExt(const size_t idx) const {
+        return std::string_view{ GetFilename(idx),
+            static_cast<size_t>(_extOffsets[idx] - _nameOffsets[idx]) };
+    }
+
+    // check if the file is a TIFF based raw image (see `utils::HasRawExtension`)
+    [[nodiscard]] inline bool IsRaw(const size_t idx) const {
+        return (_flags[idx] & FLAG_RAW) != 0;
+    }
+
+    /**
+     * @returns EXIF data of the image, nullptr if it has not been loaded
+     *          (or the image has none)
+     */
+    [[nodiscard]] const tinyexif::EXIFRecord* GetEXIF(const size_t idx) const;
+    void SetEXIF(const size_t idx, const tinyexif::EXIFRecord& exif);
+
+    /**
+     * @returns capture time packed by `PackCaptureTime`,
+     *          0 if it is not known
+     */
+    [[nodiscard]] inline uint64_t GetCaptureTime(const size_t idx) const {
+        return _captureTimes[idx];
+    }
+
+    inline void SetCaptureTime(const size_t idx, const uint64_t captureTime) {
+        _captureTimes[idx] = captureTime;
+    }
+
+    // copies the details of an image (for the UI)
+    [[nodiscard]] ImageDetails GetDetails(const size_t idx) const;
+
+    /**
+     * Linear search by path (the deleted images are also searched)
+     * @returns index of the image, `Size()` if it is not in the list
+     */
+    [[nodiscard]] size_t Find(const std::string_view filepath) const;
+
+    /**
+     * Removes the images for which `pred(idx)` returns true,
+     * keeps the order of the others
+     */
+    template<typename Pred>
+    void RemoveIf(Pred pred) {
+        std::vector<uint32_t> order;
+        order.reserve(Size());
+        for (uint32_t i = 0; i < Size(); ++i) {
+            if (!pred(static_cast<size_t>(i)))
+                order.push_back(i);
+        }
+
+        Reorder(order);
+    }
+
+    /**
+     * Sorts the images
+     * @param `comp` - compares two images by their index, `comp(a, b)`
+     *                 returns true if image `a` goes before image `b`
+     */
+    template<typename Compare>
+    void Sort(Compare comp) {
+        std::vector<uint32_t> order(Size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), comp);
+        Reorder(order);
+    }
+
+    /**
+     * Adds the images of `sorted` and merges them with the images of the
+     * list, both of which are sorted by `comp` (linear)
+     * @param `comp` - same as in `Sort`, called with the indices after
+     *                 `sorted` has been appended
+     */
+    template<typename Compare>
+    void Merge(const ImageList& sorted, Compare comp) {
+        const auto numSorted = static_cast<std::ptrdiff_t>(Size());
+        Append(sorted);
+
+        std::vector<uint32_t> order(Size());
+        std::iota(order.begin(), order.end(), 0);
+        std::inplace_merge(order.begin(), order.begin() + numSorted, order.end(), comp);
+        Reorder(order);
+    }
+
+    // bytes allocated by the list (including the EXIF side table and the
+    // deleted images)
+    [[nodiscard]] size_t GetMemoryUsage() const;
+
+    /**
+     * Packs the capture time of the EXIF data (`DateTimeOriginal` with
+     * `SubSecTimeOriginal`, else `DateTime`) as YYYYMMDDhhmmssSSS,
+     * so that it sorts in time order as an integer
+     * @returns 0 if there is no valid date-time
+     */
+    static uint64_t PackCaptureTime(const tinyexif::EXIFRecord& exif);
+
+private:
+    /**
+     * Keeps the images at the indices in `order` (in that order), the others
+     * are removed. The arena is compacted if more than half of it is unused.
+     */
+    void Reorder(const std::vector<uint32_t>& order);
+
+    // drops the paths and the EXIF data of the removed images
+    void Compact();
+
+private:
+    enum Flags : uint8_t {
+        FLAG_RAW = 1 << 0,
+        FLAG_DELETED = 1 << 1,
+    };
+
+    constexpr static uint32_t _noEXIF = UINT32_MAX;
+
+    std::vector<char> _arena; // null terminated paths
+    size_t _unusedArenaBytes = 0; // paths of the removed images
+    size_t _unusedEXIF = 0; // side table entries of the removed images
+
+    // one element per image
+    std::vector<uint32_t> _pathOffsets; // into `_arena`
+    std::vector<uint16_t> _nameOffsets; // start of the filename in the path
+    std::vector<uint16_t> _extOffsets; // start of the extension in the path
+    std::vector<uint8_t> _flags;
+    std::vector<uint32_t> _exifIndices; // into `_exif`
+    std::vector<uint64_t> _captureTimes;
+    FenwickTree _live; // 1 for the images that are not deleted
+
+    std::vector<tinyexif::EXIFRecord> _exif; // side table
+};
@@ -0,0 +1,624 @@
+#include "imageLoader.hpp"
+
+#include <cstdio>
+#include <algorithm>
+#include <vector>
+
+#include "raylib/src/external/stb_image_resize2.h"
+
+#include "bufferPool.hpp"
+#include "logger.hpp"
+#include "pixelFormat.hpp"
+#include "stbImage.hpp"
+#include "timer.hpp"
+#include "utils.hpp"
+
+
+namespace {
+
+/**
+ * Averages 2x2 blocks of `src` (the last row/column is repeated for odd
+ * sizes) into `dst`, which is `max(width / 2, 1)` x `max(height / 2, 1)`
+ * @param `channels` - bytes per pixel
+ */
+void DownscaleBox(const unsigned char* src,
+    const int width,
+    const int height,
+    const int channels,
+    unsigned char* dst) {
+    const int dstWidth = width > 1 ? width / 2 : 1;
+    const int dstHeight = height > 1 ? height / 2 : 1;
+    for (int y = 0; y < dstHeight; ++y) {
+        const unsigned char* row0 = src + static_cast<size_t>(2 * y) * width * channels;
+        const unsigned char* row1 = 2 * y + 1 < height ? row0 + static_cast<size_t>(width) * channels : row0;
+        for (int x = 0; x < dstWidth; ++x) {
+            const int x0 = 2 * x * channels;
+            const int x1 = 2 * x + 1 < width ? x0 + channels : x0;
+            for (int c = 0; c < channels; ++c) {
+                const int sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                *dst++ = static_cast<unsigned char>((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// layout of the pixels for stb_image_resize2
+bool GetPixelLayout(const int format, stbir_pixel_layout& layout) {
+    if (format == PIXELFORMAT_UNCOMPRESSED_GRAYSCALE) {
+        layout = STBIR_1CHANNEL;
+    } else if (format == PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA) {
+        layout = STBIR_RA;
+    } else if (format == PIXELFORMAT_UNCOMPRESSED_R8G8B8) {
+        layout = STBIR_RGB;
+    } else if (format == PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) {
+        layout = STBIR_RGBA;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+// same sizes as `rlLoadTexture` (halved and rounded down, at least 1)
+int GetNextLevelSize(const int size) {
+    return size > 1 ? size / 2 : 1;
+}
+
+/**
+ * @param `mipmaps` - set to the number of levels down to 1x1
+ * @returns bytes of all the levels
+ */
+uint64_t GetMipmapsSize(int width, int height, const int format, int& mipmaps) {
+    uint64_t size = static_cast<uint64_t>(GetPixelDataSize(width, height, format));
+    for (mipmaps = 1; width > 1 || height > 1; ++mipmaps) {
+        width = GetNextLevelSize(width);
+        height = GetNextLevelSize(height);
+        size += static_cast<uint64_t>(GetPixelDataSize(width, height, format));
+    }
+
+    return size;
+}
+
+} // namespace
+
+
+ImageLoader::ImageLoader(uint32_t numThreads) {
+    if (numThreads == 0) {
+        // leave one core for the render thread
+        const uint32_t cores = std::thread::hardware_concurrency();
+        numThreads = std::clamp(cores > 1 ? cores - 1 : 1u, 1u, 4u);
+    }
+
+    logger::info("Expanding pixels to RGBA with %s", pixelFormat::GetInstructionSet());
+
+    _workers.reserve(numThreads);
+    for (uint32_t i = 0; i < numThreads; ++i) {
+        _workers.emplace_back(&ImageLoader::WorkerLoop, this);
+    }
+}
+
+ImageLoader::~ImageLoader() {
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        _stop = true;
+    }
+    _cv.notify_all();
+
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+
+    for (auto& result : _results) {
+        BufferPool::Get().FreeImage(result.image);
+    }
+}
+
+uint64_t ImageLoader::Request(const std::string& filepath, const bool urgent,
+    const int displaySize, const bool preview) {
+    uint64_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        id = _nextId++;
+        LoadRequest request{ id, filepath, preview, std::make_shared<std::atomic<bool>>(false), displaySize };
+        if (urgent) {
+            _requests.push_front(std::move(request));
+        } else {
+            _requests.push_back(std::move(request));
+        }
+    }
+    _cv.notify_one();
+
+    return id;
+}
+
+void ImageLoader::Readahead(const std::vector<std::string>& filepaths) {
+    _reader.Submit(filepaths);
+}
+
+bool ImageLoader::Prioritize(const std::string& filepath) {
+    _reader.Prioritize(filepath);
+    std::lock_guard<std::mutex> lock{ _mutex };
+    const auto it = std::find_if(_requests.begin(), _requests.end(),
+        [&filepath](const LoadRequest& request) { return request.filepath == filepath; });
+    if (it == _requests.end())
+        return false;
+
+    LoadRequest request = std::move(*it);
+    request.preview = true;
+    _requests.erase(it);
+    _requests.push_front(std::move(request));
+    return true;
+}
+
+void ImageLoader::Retain(const std::unordered_set<std::string>& keep) {
+    _reader.Retain(keep);
+    std::lock_guard<std::mutex> lock{ _mutex };
+    _requests.erase(
+        std::remove_if(_requests.begin(), _requests.end(),
+            [&keep](const LoadRequest& request) { return keep.count(request.filepath) == 0; }),
+        _requests.end()
+    );
+
+    for (auto& request : _inFlight) {
+        if (keep.count(request.filepath) == 0) {
+            request.cancelled->store(true);
+        }
+    }
+}
+
+bool ImageLoader::Poll(LoadedImage& result) {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    if (_results.empty())
+        return false;
+
+    result = std::move(_results.front());
+    _results.pop_front();
+    return true;
+}
+
+void ImageLoader::Clear() {
+    _reader.Clear();
+    std::lock_guard<std::mutex> lock{ _mutex };
+    _requests.clear();
+    for (auto& request : _inFlight) {
+        request.cancelled->store(true);
+    }
+    for (auto& result : _results) {
+        BufferPool::Get().FreeImage(result.image);
+    }
+    _results.clear();
+}
+
+void ImageLoader::WorkerLoop() {
+    while (true) {
+        LoadRequest request;
+        {
+            std::unique_lock<std::mutex> lock{ _mutex };
+            _cv.wait(lock, [this]() { return _stop || !_requests.empty(); });
+            if (_stop)
+                return;
+
+            request = std::move(_requests.front());
+            _requests.pop_front();
+            _inFlight.push_back(request);
+        }
+
+        LoadedImage result = Decode(request);
+
+        {
+            std::lock_guard<std::mutex> lock{ _mutex };
+            _inFlight.erase(std::find_if(_inFlight.begin(), _inFlight.end(),
+                [&request](const LoadRequest& r) { return r.id == request.id; }));
+        }
+        PushResult(std::move(result));
+    }
+}
+
+LoadedImage ImageLoader::Decode(const LoadRequest& request) {
+    Timer t{ "Loading image \"" + request.filepath + '"' };
+
+    LoadedImage result{};
+    result.id = request.id;
+    result.filepath = request.filepath;
+
+    const auto isCancelled = [&request, &result]() {
+        result.cancelled = request.cancelled->load();
+        return result.cancelled;
+    };
+    if (isCancelled())
+        return result;
+
+    // read file
+    const char* filepath = request.filepath.c_str();
+    result.modTime = GetFileModTime(filepath);
+    // read ahead by `_reader` or mapped, the urgent image does not wait for
+    // the files queued before it
+    MappedFile file;
+    if (!_reader.Take(request.filepath, result.modTime, !request.preview, isCancelled, file)
+            && !file.Open(filepath)) {
+        logger::error("Failed to load file: %s", filepath);
+        // TODO: handle failed to load (show a toast msg)
+        return result;
+    }
+
+    // for raw files only the TIFF header and the embedded JPEG preview are read
+    const bool isRaw = utils::IsRawImage(filepath);
+    std::vector<unsigned char> rawHeader;
+    uint64_t imageDataOffset = 0;
+    uint64_t imageDataSize = file.GetSize();
+    if (isRaw) {
+        tinyexif::JPEGPreview preview{};
+        if (!FindRawPreview(file, preview, rawHeader)) {
+            logger::error("Failed to find the JPEG preview in raw file: %s", filepath);
+            // TODO: handle failed to load (show a toast msg)
+            return result;
+        }
+
+        imageDataOffset = preview.Offset;
+        imageDataSize = preview.Length;
+    }
+
+    // mapped, or a buffer that the chunks are read into
+    if (!file.SetRange(imageDataOffset, imageDataSize)) {
+        logger::error("Failed to read file: %s", filepath);
+        return result;
+    }
+    const unsigned char* imageData = file.GetData();
+    // read in chunks so that a cancelled request stops early
+    const auto readChunks = [&](const uint64_t begin, const uint64_t end) {
+        for (uint64_t offset = begin; offset < end; offset += _readChunkSize) {
+            if (isCancelled())
+                return false;
+
+            const uint64_t size = std::min(_readChunkSize, end - offset);
+            if (!file.Read(offset, offset + size)) {
+                logger::error("Failed to read file: %s", filepath);
+                // TODO: handle failed to load (show a toast msg)
+                return false;
+            }
+        }
+
+        return !isCancelled();
+    };
+
+    // the EXIF data (and the thumbnail in it) is at the start of the file,
+    // so it is parsed before the rest of the file is read
+    const uint64_t headerSize = std::min(_headerSize, imageDataSize);
+    if (!readChunks(0, headerSize))
+        return result;
+
+    tinyexif::EXIFRecord exif{};
+    if (isRaw) {
+        result.exifErrCode = ParseHeader(rawHeader.data(), rawHeader.size(), true, exif);
+    } else {
+        result.exifErrCode = ParseHeader(imageData, headerSize, false, exif);
+    }
+    if (result.exifErrCode == PARSE_EXIF_SUCCESS) {
+        result.exif = exif;
+    }
+
+    // only reads the header
+    int comp = 0; // image components (R, G, B, A)
+    stbImage::InfoFromMemory(
+        imageData,
+        static_cast<int>(headerSize),
+        result.imageWidth,
+        result.imageHeight,
+        comp
+    );
+    // the frame header can be past the header (large ICC profiles)
+    if (result.imageWidth == 0 && result.exif.has_value()) {
+        result.imageWidth = static_cast<int>(result.exif->ImageWidth);
+        result.imageHeight = static_cast<int>(result.exif->ImageHeight);
+    }
+
+    // show the embedded thumbnail while the rest of the image is being read
+    // and decoded
+    if (request.preview && result.exif.has_value()
+            && result.exif->ThumbnailLength > 0) {
+        LoadedImage preview{};
+        preview.id = result.id;
+        preview.filepath = result.filepath;
+        preview.modTime = result.modTime;
+        preview.isPreview = true;
+        preview.exifErrCode = result.exifErrCode;
+        preview.exif = result.exif;
+        preview.imageWidth = result.imageWidth;
+        preview.imageHeight = result.imageHeight;
+
+        Image& thumbnail = preview.image;
+        thumbnail.data = stbImage::LoadFromMemory(
+            imageData + result.exif->ThumbnailOffset,
+            static_cast<int>(result.exif->ThumbnailLength),
+            thumbnail.width,
+            thumbnail.height,
+            comp
+        );
+
+        if (thumbnail.data != nullptr) {
+            SetPixelFormat(thumbnail, comp);
+            preview.success = true;
+            PushResult(std::move(preview));
+        }
+    }
+
+    if (!readChunks(headerSize, imageDataSize))
+        return result;
+
+    // the EXIF segment did not fit in the header
+    if (result.exifErrCode == PARSE_EXIF_ERROR_TRUNCATED) {
+        result.exifErrCode = ParseHeader(imageData, imageDataSize, false, exif);
+        if (result.exifErrCode == PARSE_EXIF_SUCCESS) {
+            result.exif = exif;
+        }
+    }
+
+    // check for error when parsing EXIF data
+    if (result.exifErrCode == PARSE_EXIF_ERROR_NO_EXIF) {
+        logger::info("EXIF data not found!");
+    } else if (result.exifErrCode == PARSE_EXIF_ERROR_NO_JPEG) {
+        logger::warn("Cannot parse EXIF data for non-JPEG images!");
+    } else if (result.exifErrCode == PARSE_EXIF_ERROR_UNKNOWN_BYTEALIGN) {
+        logger::error("Error reading EXIF data (UNKNOWN BYTE ALIGNMENT)!");
+    } else if (result.exifErrCode == PARSE_EXIF_ERROR_CORRUPT) {
+        logger::error("Error reading EXIF data (DATA CORRUPTED)!");
+    }
+
+    if (isCancelled())
+        return result;
+
+    Image& image = result.image;
+    image.data = stbImage::LoadFromMemory(
+        imageData,
+        static_cast<int>(imageDataSize),
+        image.width,
+        image.height,
+        comp
+    );
+    file.Close();
+
+    if (image.data == nullptr) {
+        logger::error("Failed to decode image: %s", filepath);
+        return result;
+    }
+
+    if (isCancelled()) {
+        BufferPool::Get().FreeImage(image);
+        return result;
+    }
+
+    SetPixelFormat(image, comp);
+    result.imageWidth = image.width;
+    result.imageHeight = image.height;
+
+    // fit to the window, the full resolution is requested when zoomed in
+    result.downscaled = Downscale(image, request.displaySize);
+
+    // the image is usually drawn much smaller than it is, sampling the full
+    // resolution texture aliases
+    if (!GenerateMipmaps(image)) {
+        logger::warn("Failed to generate mipmaps: %s", filepath);
+    }
+
+    // after downscaling, there are fewer pixels to expand
+    if (!ExpandToRGBA(image)) {
+        logger::warn("Failed to expand the pixels to RGBA: %s", filepath);
+    }
+
+    if (isCancelled()) {
+        BufferPool::Get().FreeImage(image);
+        return result;
+    }
+
+    result.success = true;
+    return result;
+}
+
+bool ImageLoader::ReadMetadata(const std::string& filepath, ImageMetadata& metadata) {
+    metadata = ImageMetadata{};
+    metadata.modTime = GetFileModTime(filepath.c_str());
+    MappedFile file;
+    if (!file.Open(filepath.c_str()))
+        return false;
+
+    const bool isRaw = utils::IsRawImage(filepath.c_str());
+    std::vector<unsigned char> rawHeader;
+    const unsigned char* header = nullptr;
+    uint64_t headerSize = 0;
+    if (isRaw) {
+        tinyexif::JPEGPreview preview{};
+        if (!FindRawPreview(file, preview, rawHeader))
+            return false;
+
+        header = rawHeader.data();
+        headerSize = rawHeader.size();
+        metadata.imageWidth = static_cast<int>(preview.Width);
+        metadata.imageHeight = static_cast<int>(preview.Height);
+    } else {
+        headerSize = std::min(_headerSize, file.GetSize());
+        if (!file.SetRange(0, headerSize) || !file.Read(0, headerSize))
+            return false;
+        header = file.GetData();
+
+        // PNG IHDR or JPEG SOF
+        int comp = 0;
+        stbImage::InfoFromMemory(
+            header,
+            static_cast<int>(headerSize),
+            metadata.imageWidth,
+            metadata.imageHeight,
+            comp
+        );
+    }
+
+    metadata.exifErrCode = ParseHeader(header, headerSize, isRaw, metadata.exif);
+
+    if (metadata.exifErrCode == PARSE_EXIF_SUCCESS
+            && (metadata.imageWidth == 0 || metadata.imageHeight == 0)) {
+        metadata.imageWidth = static_cast<int>(metadata.exif.ImageWidth);
+        metadata.imageHeight = static_cast<int>(metadata.exif.ImageHeight);
+    }
+
+    return true;
+}
+
+int ImageLoader::ParseHeader(const unsigned char* header,
+    const uint64_t size,
+    const bool isRaw,
+    tinyexif::EXIFRecord& exif) {
+    if (!isRaw)
+        return tinyexif::parseFromHeader(header, static_cast<unsigned>(size), exif);
+
+    // the EXIF data is in the IFDs of the raw file, not in the preview
+    const int errCode = tinyexif::parseFromTIFF(header, static_cast<unsigned>(size), exif);
+    // the thumbnail offset is relative to the header
+    exif.ThumbnailLength = 0;
+    return errCode;
+}
+
+bool ImageLoader::FindRawPreview(const MappedFile& file,
+    tinyexif::JPEGPreview& preview,
+    std::vector<unsigned char>& header) {
+    const auto readRange = [](void* user, unsigned long long offset, unsigned char* dst, unsigned size) {
+        return static_cast<const MappedFile*>(user)->ReadAt(offset, dst, size);
+    };
+
+    void* user = const_cast<MappedFile*>(&file);
+    if (tinyexif::findJPEGPreview(readRange, user, file.GetSize(), preview) != PARSE_EXIF_SUCCESS)
+        return false;
+
+    header.resize(std::min(_headerSize, file.GetSize()));
+    return file.ReadAt(0, header.data(), header.size());
+}
+
+void ImageLoader::SetPixelFormat(Image& image, const int comp) {
+    image.mipmaps = 1;
+    if (comp == 1) {
+        image.format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE;
+    } else if (comp == 2) {
+        image.format = PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA;
+    } else if (comp == 3) {
+        image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8;
+    } else if (comp == 4) {
+        image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    }
+}
+
+bool ImageLoader::Downscale(Image& image, const int displaySize) {
+    const int size = std::max(image.width, image.height);
+    stbir_pixel_layout layout{};
+    if (displaySize <= 0 || size <= 2 * displaySize
+            || image.width < _minResizeWidth || !GetPixelLayout(image.format, layout))
+        return false;
+
+    const double scale = 2.0 * displaySize / size;
+    const int width = std::max(static_cast<int>(image.width * scale), 1);
+    const int height = std::max(static_cast<int>(image.height * scale), 1);
+    // with room for the mipmaps, so that `GenerateMipmaps` does not copy it
+    int mipmaps = 0;
+    BufferPool& pool = BufferPool::Get();
+    void* data = pool.Allocate(GetMipmapsSize(width, height, image.format, mipmaps));
+    if (data == nullptr)
+        return false;
+
+    if (stbir_resize_uint8_srgb(static_cast<const unsigned char*>(image.data), image.width, image.height, 0,
+            static_cast<unsigned char*>(data), width, height, 0, layout) == nullptr) {
+        pool.Free(data);
+        return false;
+    }
+
+    pool.Free(image.data);
+    image.data = data;
+    image.width = width;
+    image.height = height;
+    return true;
+}
+
+bool ImageLoader::GenerateMipmaps(Image& image) {
+    stbir_pixel_layout layout{};
+    if (!GetPixelLayout(image.format, layout))
+        return false;
+
+    int mipmaps = 0;
+    const uint64_t totalSize = GetMipmapsSize(image.width, image.height, image.format, mipmaps);
+    if (totalSize > UINT32_MAX)
+        return false;
+
+    unsigned char* data = static_cast<unsigned char*>(BufferPool::Get().Reallocate(image.data,
+        static_cast<size_t>(GetPixelDataSize(image.width, image.height, image.format)),
+        static_cast<size_t>(totalSize)));
+    if (data == nullptr)
+        return false;
+    image.data = data;
+
+    unsigned char* level = data;
+    int width = image.width;
+    int height = image.height;
+    for (int i = 1; i < mipmaps; ++i) {
+        unsigned char* next = level + GetPixelDataSize(width, height, image.format);
+        const int nextWidth = GetNextLevelSize(width);
+        const int nextHeight = GetNextLevelSize(height);
+        // stb_image_resize2 (v2.01) reads out of bounds for images narrower
+        // than 18 pixels, the smallest levels are box filtered instead
+        if (width < _minResizeWidth) {
+            DownscaleBox(level, width, height, GetPixelDataSize(1, 1, image.format), next);
+        } else if (stbir_resize_uint8_srgb(level, width, height, 0,
+                next, nextWidth, nextHeight, 0, layout) == nullptr) {
+            image.mipmaps = 1;
+            return false;
+        }
+
+        level = next;
+        width = nextWidth;
+        height = nextHeight;
+    }
+
+    image.mipmaps = mipmaps;
+    return true;
+}
+
+bool ImageLoader::ExpandToRGBA(Image& image) {
+    int channels = 0;
+    if (image.format == PIXELFORMAT_UNCOMPRESSED_GRAYSCALE) {
+        channels = 1;
+    } else if (image.format == PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA) {
+        channels = 2;
+    } else if (image.format == PIXELFORMAT_UNCOMPRESSED_R8G8B8) {
+        channels = 3;
+    } else {
+        return image.format == PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    }
+
+    // the levels are contiguous, they are expanded in one pass
+    uint64_t count = 0;
+    int width = image.width;
+    int height = image.height;
+    for (int i = 0; i < image.mipmaps; ++i) {
+        count += static_cast<uint64_t>(width) * height;
+        width = GetNextLevelSize(width);
+        height = GetNextLevelSize(height);
+    }
+    if (count * 4 > UINT32_MAX)
+        return false;
+
+    BufferPool& pool = BufferPool::Get();
+    unsigned char* data = static_cast<unsigned char*>(pool.Allocate(static_cast<size_t>(count * 4)));
+    if (data == nullptr)
+        return false;
+
+    pixelFormat::ExpandToRGBA(static_cast<const unsigned char*>(image.data), channels, count, data);
+    pool.Free(image.data);
+    image.data = data;
+    image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    return true;
+}
+
+void ImageLoader::PushResult(LoadedImage&& result) {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    if (_stop) {
+        BufferPool::Get().FreeImage(result.image);
+        return;
+    }
+
+    _results.push_back(std::move(result));
+}
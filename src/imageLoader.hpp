@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <optional>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "raylib.h"
+#include "tinyexif/exif.h"
+#include "mappedFile.hpp"
+#include "batchReader.hpp"
+
+
+struct LoadRequest {
+    uint64_t id;
+    std::string filepath;
+    bool preview; // also return the embedded EXIF thumbnail (if any)
+    std::shared_ptr<std::atomic<bool>> cancelled; // set by `ImageLoader::Retain`
+    int displaySize; // see `ImageLoader::Request`
+};
+
+// decoded image handed back from a worker thread to the main thread
+struct LoadedImage {
+    uint64_t id = 0;
+    std::string filepath;
+    long modTime = 0; // modification time of the file when it was read
+    bool success = false;
+    bool cancelled = false; // dropped by `ImageLoader::Retain` before it was done
+    // `image` is the embedded EXIF thumbnail, the full image follows
+    // in another result with the same id
+    bool isPreview = false;
+    bool downscaled = false; // `image` is smaller than the full image
+    Image image{}; // owned by the receiver, free using `BufferPool::FreeImage`
+    int imageWidth = 0; // width of the full image
+    int imageHeight = 0; // height of the full image
+    int exifErrCode = PARSE_EXIF_ERROR_NO_EXIF;
+    std::optional<tinyexif::EXIFRecord> exif; // if `exifErrCode` is PARSE_EXIF_SUCCESS
+};
+
+// metadata read from the start of an image file, see `ImageLoader::ReadMetadata`
+struct ImageMetadata {
+    long modTime = 0;
+    int imageWidth = 0;
+    int imageHeight = 0;
+    int exifErrCode = PARSE_EXIF_ERROR_NO_EXIF;
+    // filled without heap allocations, valid if `exifErrCode` is PARSE_EXIF_SUCCESS
+    tinyexif::EXIFRecord exif{};
+};
+
+/**
+ * Reads and decodes images on a pool of worker threads. The main thread
+ * queues requests with `Request` and collects the decoded images with `Poll`,
+ * so that only the texture upload (which needs the GL context) happens on the
+ * render thread.
+ */
+class ImageLoader {
+public:
+    /**
+     * @param `numThreads` - number of worker threads
+     *                       (0 = based on the hardware concurrency)
+     */
+    explicit ImageLoader(uint32_t numThreads = 0);
+    ~ImageLoader();
+
+    ImageLoader(const ImageLoader&) = delete;
+    ImageLoader(ImageLoader&&) = delete;
+    ImageLoader& operator=(const ImageLoader&) = delete;
+    ImageLoader& operator=(ImageLoader&&) = delete;
+
+    /**
+     * Queues an image to be decoded in the background
+     * @param `filepath` - path of the image file
+     * @param `urgent` - queue in front of the other requests (for the image
+     *                   that is to be displayed)
+     * @param `displaySize` - larger images are downscaled to twice this
+     *                        size after they are decoded (0 = full resolution)
+     * @param `preview` - return the EXIF thumbnail first (for an image that
+     *                    is not on screen yet)
+     * @returns id of the request (never 0)
+     */
+    uint64_t Request(const std::string& filepath, const bool urgent = false,
+        const int displaySize = 0, const bool preview = false);
+
+    /**
+     * Reads the files ahead of their requests, as one batch (see
+     * `BatchReader`), the workers decode them from the buffers
+     * @param `filepaths` - of the images that were just requested
+     */
+    void Readahead(const std::vector<std::string>& filepaths);
+
+    /**
+     * Moves a queued request to the front of the queue (and makes it urgent)
+     * @param `filepath` - path of the image file
+     * @returns false if the image is not in the queue
+     *          (it is either being decoded or was never requested)
+     */
+    bool Prioritize(const std::string& filepath);
+
+    /**
+     * Cancels the requests for the images that are not in `keep`. Queued
+     * requests are dropped, in-flight ones stop at the next checkpoint
+     * (between reading chunks of the file and between decoding stages)
+     * and are returned by `Poll` with `cancelled` set.
+     *
+     * @param `keep` - file paths of the images that are still needed
+     */
+    void Retain(const std::unordered_set<std::string>& keep);
+
+    /**
+     * Pops a decoded image, if any. Does not block.
+     * @param `result` - filled with the decoded image
+     * @returns true if a result was popped
+     */
+    bool Poll(LoadedImage& result);
+
+    // drops the queued requests and the decoded images that were not polled yet
+    void Clear();
+
+    /**
+     * Reads the dimensions and the EXIF data of an image without decoding it.
+     * Only the first `_headerSize` bytes of the file are read (the TIFF
+     * header and the IFDs for raw files). Blocks, so call it from a
+     * background thread when querying many files.
+     *
+     * @param `filepath` - path of the image file
+     * @param `metadata` - filled with the metadata
+     * @returns false if the file could not be read
+     */
+    static bool ReadMetadata(const std::string& filepath, ImageMetadata& metadata);
+
+private:
+    void WorkerLoop();
+
+    /**
+     * Reads the file, parses the EXIF data and decodes the pixels. The EXIF
+     * data is parsed from the first `_headerSize` bytes, for urgent requests
+     * the embedded thumbnail is pushed as a preview before the rest of the
+     * file is read. Raw files are decoded from their embedded JPEG
+     * preview. The file is decoded straight from its mapping (see
+     * `MappedFile`). Runs on the worker threads.
+     */
+    LoadedImage Decode(const LoadRequest& request);
+
+    /**
+     * Parses the EXIF data from the start of the file (without heap
+     * allocations). JPEG markers are walked up to the start of the scan, raw
+     * files are parsed as TIFF.
+     * @param `header` - first bytes of the file
+     * @returns PARSE_EXIF_* code, PARSE_EXIF_ERROR_TRUNCATED if the EXIF
+     *          segment continues past `size`
+     */
+    static int ParseHeader(const unsigned char* header,
+        const uint64_t size,
+        const bool isRaw,
+        tinyexif::EXIFRecord& exif);
+
+    /**
+     * Walks the IFDs of a raw file to find its largest embedded JPEG preview
+     * and reads the start of the file (for the EXIF data)
+     * @param `preview` - filled with the location of the preview
+     * @param `header` - filled with the first `_headerSize` bytes
+     * @returns false if there is no preview that can be decoded
+     */
+    static bool FindRawPreview(const MappedFile& file,
+        tinyexif::JPEGPreview& preview,
+        std::vector<unsigned char>& header);
+
+    // sets the raylib pixel format from the number of components
+    static void SetPixelFormat(Image& image, const int comp);
+
+    /**
+     * Resizes the image to twice `displaySize` (in sRGB, alpha weighted), so
+     * that it is not uploaded and cached at a resolution that is not shown
+     * @param `displaySize` - max width and height of the image on screen
+     * @returns false if the image was kept as it is
+     */
+    static bool Downscale(Image& image, const int displaySize);
+
+    /**
+     * Appends the mipmap levels (down to 1x1) after the pixels, each level
+     * is downscaled from the previous one (in sRGB, alpha weighted). The
+     * levels are laid out the way raylib uploads them.
+     * @returns false if the levels could not be generated
+     *          (`image` is left with its first level only)
+     */
+    static bool GenerateMipmaps(Image& image);
+
+    /**
+     * Expands gray, gray + alpha and RGB pixels (all the mipmap levels) to
+     * RGBA8, which the drivers upload without converting them
+     * @returns false if the pixels could not be expanded
+     *          (`image` is left as it was)
+     */
+    static bool ExpandToRGBA(Image& image);
+
+    // queues a decoded image to be returned by `Poll`
+    void PushResult(LoadedImage&& result);
+
+private:
+    constexpr static uint64_t _readChunkSize = 4 * 1024 * 1024;
+    // read before the rest of the file, holds the EXIF segment (at most 64 KB)
+    // of JPEGs and the IFD0 and EXIF IFD of raw files
+    constexpr static uint64_t _headerSize = 128 * 1024;
+    // narrower mipmap levels are not downscaled with stb_image_resize2
+    constexpr static int _minResizeWidth = 32;
+
+    BatchReader _reader;
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::deque<LoadRequest> _requests;
+    std::vector<LoadRequest> _inFlight; // requests being decoded
+    std::deque<LoadedImage> _results;
+    uint64_t _nextId = 1;
+    bool _stop = false;
+};
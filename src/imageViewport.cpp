@@ -1,13 +1,14 @@
 #include "imageViewport.hpp"
 
 #include <filesystem>
+#include <algorithm>
+#include <cstring>
 
 #include "raylib.h"
-#include "raylib/src/external/stb_image.h"
 
+#include "bufferPool.hpp"
 #include "logger.hpp"
 #include "utils.hpp"
-#include "timer.hpp"
 
 
 ImageViewport::ImageViewport(const ImageViewportInfo& info)
@@ -17,7 +18,8 @@ ImageViewport::ImageViewport(const ImageViewportInfo& info)
       _camera{},
       _images{},
       _imageRotation{ ImageRotation::NONE },
-      _originalRotation{ ImageRotation::NONE } {
+      _originalRotation{ ImageRotation::NONE },
+      _textures{ info.textureCacheSize, info.imageCacheSize, info.textureFiltering } {
     Init();
 }
 
@@ -26,28 +28,174 @@ void ImageViewport::Init() {
 }
 
 void ImageViewport::Cleanup() {
-    UnloadTexture(_texture);
+    CancelLoading();
+    _stream.Close();
+    _scanning = false;
+    _catalog.Close();
+
+    UnloadPreview();
+    _tiles.Clear();
+    _textures.Clear();
+    _texture = Texture2D{};
+    _displayedPath.clear();
+    _uploadingPath.clear();
+}
+
+void ImageViewport::CancelLoading() {
+    _loader.Clear();
+    _pendingRequests.clear();
+    _prefetchPaths.clear();
+    _navDirection = 0;
+    _navStreak = 0;
+    _prefetchDue = false;
 }
 
 void ImageViewport::Draw() {
-    if (_images.empty())
+    if (_images.Empty())
         return;
 
     BeginMode2D(_camera);
 
     const Vector2 origin{ _dstRectangle.width / 2.0f, _dstRectangle.height / 2.0f };
-    DrawTexturePro(
-        _texture,
-        _srcRectangle,
-        _dstRectangle,
-        origin,
-        static_cast<float>(_imageRotation),
-        WHITE
-    );
+    if (!_tiles.Empty()) {
+        _tiles.Draw(_camera, _dstRectangle, origin, static_cast<float>(_imageRotation));
+    } else {
+        DrawTexturePro(
+            _texture,
+            _srcRectangle,
+            _dstRectangle,
+            origin,
+            static_cast<float>(_imageRotation),
+            WHITE
+        );
+    }
 
     EndMode2D();
 }
 
+void ImageViewport::Update() {
+    if (_scanning) {
+        PollDirectoryStream();
+    }
+
+    // the capture times and cameras of the images that were not in the
+    // catalog are known now
+    if (_catalog.PollFinished()) {
+        if (!_cameraFilter.empty()) {
+            ApplyFilter();
+        } else if (_sortOrder != SortOrder::NAME) {
+            ResortImages();
+        }
+    }
+
+    if (_prefetchDue && GetTime() - _lastNavTime >= _skimInterval) {
+        _prefetchDue = false;
+        PrefetchNeighbors();
+    }
+
+    std::vector<std::string> restored;
+    if (_trash.PollRestored(restored)) {
+        for (const std::string& filepath : restored) {
+            const auto pending = _pendingRestores.find(filepath);
+            if (pending == _pendingRestores.end())
+                continue;
+
+            const bool inList = pending->second;
+            _pendingRestores.erase(pending);
+            if (_pairingReady) {
+                _pairing.Add(filepath);
+            }
+            if (inList) {
+                RestoreImage(filepath);
+            }
+        }
+    }
+
+    // deleting only marks the images, they are dropped once the user stops
+    // navigating so that the list is not shifted on every delete
+    if (_images.DeletedCount() > 0 && GetTime() - _lastNavTime >= _compactDelay) {
+        RemoveDeletedImages();
+    }
+
+    std::vector<LoadedImage> results;
+    LoadedImage polled;
+    while (_loader.Poll(polled)) {
+        results.push_back(std::move(polled));
+    }
+
+    for (auto& loaded : results) {
+        if (loaded.isPreview) {
+            // no need for the preview if the full image is here too
+            const bool hasFullImage = std::any_of(results.begin(), results.end(),
+                [&loaded](const LoadedImage& r) { return r.id == loaded.id && !r.isPreview; });
+            if (!hasFullImage && !_images.Empty()
+                    && loaded.filepath == GetCurrentPath()
+                    && _displayedPath != loaded.filepath) {
+                ShowPreview(loaded);
+            }
+            BufferPool::Get().FreeImage(loaded.image);
+            continue;
+        }
+
+        auto pending = _pendingRequests.find(loaded.filepath);
+        if (pending != _pendingRequests.end() && pending->second == loaded.id) {
+            _pendingRequests.erase(pending);
+            pending = _pendingRequests.end();
+        }
+
+        const bool isCurrent =
+            !_images.Empty() && loaded.filepath == GetCurrentPath();
+        const bool isWanted = isCurrent || _prefetchPaths.count(loaded.filepath) != 0;
+
+        if (loaded.cancelled) {
+            // we navigated back to it before it was dropped
+            if (isWanted && pending == _pendingRequests.end()) {
+                // (the full resolution replaces an image that is on screen)
+                const bool fullResolution = loaded.filepath == _fullResolutionPath;
+                _pendingRequests[loaded.filepath] = _loader.Request(loaded.filepath, isCurrent,
+                    fullResolution ? 0 : GetDisplaySize(), isCurrent && !fullResolution);
+            }
+            continue;
+        }
+
+        // drop failed images and the ones we have navigated away from
+        if (!loaded.success || !isWanted) {
+            // TODO: handle failed to load (show a toast msg)
+            BufferPool::Get().FreeImage(loaded.image);
+            continue;
+        }
+
+        const CachedTexture& cached = _textures.Insert(loaded);
+        if (isCurrent) {
+            ShowImage(cached);
+        }
+    }
+
+    _textures.Update();
+    ShowUploadedImage();
+    RequestFullResolution();
+}
+
+void ImageViewport::UpdateTextureFiltering(const TextureFiltering filtering) {
+    _info.textureFiltering = filtering;
+    _textures.SetFiltering(filtering);
+    _tiles.SetFiltering(filtering);
+}
+
+bool ImageViewport::IsIdle() const {
+    // the compaction and the prefetch are waiting for a timeout, and the
+    // pending moves are shown in the image info window
+    return !_scanning
+        && !_catalog.IsBusy()
+        && _pendingRequests.empty()
+        && !_prefetchDue
+        && _images.DeletedCount() == 0
+        && _pendingRestores.empty()
+        && _trash.GetStatus().pending == 0
+        && !_tiles.IsLoading()
+        && !_textures.IsUploading();
+}
+
 void ImageViewport::Resize(const uint64_t width, const uint64_t height) {
     _info.windowWidth = width;
     _info.windowHeight = height;
@@ -82,12 +230,18 @@ void ImageViewport::LoadFilesFromList(const FilePathList& files) {
     if (files.count <= 0)
         return;
 
-    Cleanup();
-    if (!_images.empty()) {
-        _images.clear();
-    }
-
-    _images.reserve(files.count);
+    CancelLoading();
+    _stream.Close();
+    _scanning = false;
+    _images.Clear();
+    _filteredOut.Clear();
+    _cameraFilter.clear();
+    // the deletes can only be undone in the list they were made in
+    _deleteHistory.clear();
+    _pendingRestores.clear();
+    _pairing.Clear(_info.rawImageExt);
+    _pairingReady = false;
+    _images.Reserve(files.count, 0);
     for (uint64_t i = 0; i < files.count; ++i) {
         const char* path = files.paths[i];
         // check if the file is png/jpg or not
@@ -95,14 +249,18 @@ void ImageViewport::LoadFilesFromList(const FilePathList& files) {
             continue;
         }
 
-        _images.emplace_back(path);
+        _images.PushBack(path);
     }
+    RemovePairedRawImages();
+    // the catalog is per directory, dropped files can be a subset of it
+    _catalog.Close();
+    SortImages();
 
     _currentImageIdx = 0;
     CalcDstRectangle();
     UpdateImagePath(GetDirectoryPath(files.paths[0]));
 
-    if (_images.empty()) {
+    if (_images.Empty()) {
         logger::info("No images found!");
     } else {
         LoadCurrentImage();
@@ -112,38 +270,336 @@ void ImageViewport::LoadFilesFromList(const FilePathList& files) {
 }
 
 void ImageViewport::LoadFilesFromDir(const char* path) {
-    Cleanup();
-    if (!_images.empty()) {
-        _images.clear();
-    }
+    CancelLoading();
+    _stream.Close();
+    _catalog.Close();
+    _images.Clear();
+    _filteredOut.Clear();
+    _cameraFilter.clear();
+    // the deletes can only be undone in the list they were made in
+    _deleteHistory.clear();
+    _pendingRestores.clear();
+    _pairing.Clear(_info.rawImageExt);
+    _pairingReady = false;
+    _scanHasRaws = false;
+    _currentImageIdx = 0;
 
+    // the images are added in `Update` as they are listed
     const std::filesystem::path filesPath{ path };
-    _images.reserve(std::distance(
-        std::filesystem::directory_iterator(filesPath),
-        std::filesystem::directory_iterator()
-    ));
-
-    for (const auto& file : std::filesystem::directory_iterator{ filesPath }) {
-        // in windows path().c_str() gives wide char
-        const std::string fpath = file.path().string();
-        // check if the file is png/jpg or not
-        if (!utils::IsValidImage(fpath.c_str())) {
-            continue;
-        }
+    _scanDirectory = std::filesystem::absolute(filesPath).lexically_normal().string();
+    _stream.Open(filesPath.string(), _info.rawImagePath, _info.rawImageExt);
+    _scanning = true;
+}
 
-        _images.emplace_back(fpath.c_str());
+void ImageViewport::PollDirectoryStream() {
+    // merging is linear in the number of images, so once an image is on
+    // screen the batches are only merged every `_scanPollInterval`
+    const double now = GetTime();
+    if (!_images.Empty() && now - _lastScanPoll < _scanPollInterval)
+        return;
+
+    _lastScanPoll = now;
+    ImageList batch;
+    if (_stream.Poll(batch)) {
+        AddImages(batch);
     }
 
-    _currentImageIdx = 0;
-    CalcDstRectangle();
+    if (!_stream.IsDone())
+        return;
 
-    if (_images.empty()) {
+    const ScanStats stats = _stream.GetStats();
+    logger::info("Scanned %llu entries, %llu images (%llu stat calls)",
+        static_cast<unsigned long long>(stats.entries),
+        static_cast<unsigned long long>(stats.images),
+        static_cast<unsigned long long>(stats.statCalls));
+    logger::info("Image list: %llu images, %.1f bytes per image",
+        static_cast<unsigned long long>(_images.Size()),
+        _images.Size() == 0 ? 0.0
+            : static_cast<double>(_images.GetMemoryUsage()) / static_cast<double>(_images.Size()));
+
+    _pairing = _stream.TakePairingIndex();
+    _pairingReady = true;
+    _stream.Close();
+    _scanning = false;
+
+    if (_images.Empty()) {
         logger::info("No images found!");
+        return;
+    }
+
+    // the catalog gives the metadata before any image gets decoded
+    std::vector<std::string> filenames;
+    filenames.reserve(_images.LiveCount());
+    for (size_t i = 0; i < _images.Size(); ++i) {
+        if (!_images.IsDeleted(i)) {
+            filenames.emplace_back(_images.GetFilename(i));
+        }
+    }
+    _catalog.Open(_scanDirectory, std::move(filenames), _info.trashDir);
+
+    // the capture times of the images that were in the catalog are known now
+    if (_sortOrder != SortOrder::NAME) {
+        ResortImages();
+    }
+}
+
+void ImageViewport::AddImages(ImageList& batch) {
+    for (size_t i = 0; i < batch.Size() && !_scanHasRaws; ++i) {
+        _scanHasRaws = batch.IsRaw(i);
+    }
+
+    const bool wasEmpty = _images.Empty();
+    const std::string currentPath = wasEmpty ? "" : GetCurrentPath();
+    const std::string currentStem{ wasEmpty ? "" : _images.GetStem(_currentImageIdx) };
+
+    // the catalog is opened once the directory has been listed, until then
+    // `SortImages` gives the name order for both sort orders
+    batch.Sort([&batch](const size_t a, const size_t b) {
+        return std::strcmp(batch.GetFilename(a), batch.GetFilename(b)) < 0;
+    });
+    _images.Merge(batch, [this](const size_t a, const size_t b) {
+        return std::strcmp(_images.GetFilename(a), _images.GetFilename(b)) < 0;
+    });
+
+    // a raw image is dropped when its jpg/png is found, before or after it
+    if (_scanHasRaws) {
+        RemovePairedRawImages();
+    }
+
+    if (wasEmpty) {
+        if (_images.Empty())
+            return;
+
+        // show the first image found while the rest is being listed
+        _currentImageIdx = static_cast<int64_t>(_images.NthLive(0));
+        CalcDstRectangle();
+        LoadCurrentImage();
+        Reset();
+        return;
+    }
+
+    // keep the current image on screen, if it was a raw image that got
+    // paired, show its jpg/png instead
+    size_t idx = _images.Find(currentPath);
+    const bool replaced = idx == _images.Size();
+    for (size_t i = 0; replaced && i < _images.Size(); ++i) {
+        if (!_images.IsDeleted(i) && _images.GetStem(i) == currentStem) {
+            idx = i;
+            break;
+        }
+    }
+    _currentImageIdx = static_cast<int64_t>(idx < _images.Size() ? idx : _images.NthLive(0));
+
+    if (replaced) {
+        LoadCurrentImage();
+    } else if (!_prefetchDue) {
+        // the neighbors might have changed
+        PrefetchNeighbors();
+        CancelStaleRequests();
+    }
+}
+
+void ImageViewport::RemovePairedRawImages() {
+    // paths without the extension of the jpg/png images
+    std::unordered_set<std::string_view> stems;
+    for (size_t i = 0; i < _images.Size(); ++i) {
+        if (!_images.IsRaw(i) && !_images.IsDeleted(i)) {
+            stems.insert(_images.GetStem(i));
+        }
+    }
+
+    _images.RemoveIf([this, &stems](const size_t idx) {
+        return _images.IsRaw(idx) && stems.count(_images.GetStem(idx)) > 0;
+    });
+}
+
+void ImageViewport::RestoreImage(const std::string& filepath) {
+    // the image is still in the list if it has not been dropped yet,
+    // otherwise it is merged back in the sort order
+    size_t idx = _images.Find(filepath);
+    if (idx < _images.Size()) {
+        _images.Restore(idx);
     } else {
+        ImageList restored;
+        restored.PushBack(filepath);
+        if (_sortOrder == SortOrder::DATE_TAKEN) {
+            restored.SetCaptureTime(0, GetCatalogCaptureTime(restored.GetFilename(0)));
+        }
+        _images.Merge(restored, [this](const size_t a, const size_t b) { return CompareImages(a, b); });
+        idx = _images.Find(filepath);
+    }
+
+    if (idx >= _images.Size())
+        return;
+
+    // its texture is still cached if it has not been evicted
+    _currentImageIdx = static_cast<int64_t>(idx);
+    UpdateNavDirection(0);
+    CalcDstRectangle();
+    LoadCurrentImage();
+}
+
+std::vector<std::string> ImageViewport::GetSiblingPaths(const std::string& filepath) const {
+    if (_pairingReady)
+        return _pairing.GetSiblings(filepath);
+
+    // the directory is still being listed, the raw image might not exist
+    const size_t nameStart = filepath.find_last_of("\\/") + 1;
+    const size_t extStart = filepath.find_last_of('.');
+    const std::string stem = filepath.substr(nameStart,
+        extStart != std::string::npos && extStart > nameStart ? extStart - nameStart : std::string::npos);
+    const std::string rawImage = _info.rawImagePath + stem + _info.rawImageExt;
+    if (rawImage == filepath)
+        return {};
+
+    return { rawImage };
+}
+
+void ImageViewport::TrashFiles(const DeletedImage& deleted) {
+    logger::log("moving: \"%s\" to \"%s\"", deleted.filepath.c_str(), deleted.trashDir.c_str());
+    _trash.Push(deleted.filepath, deleted.trashDir, deleted.listIndex);
+    for (const std::string& sibling : deleted.siblingPaths) {
+        _trash.Push(sibling, deleted.trashDir, deleted.listIndex, true);
+    }
+
+    if (_pairingReady) {
+        _pairing.Remove(deleted.filepath);
+        for (const std::string& sibling : deleted.siblingPaths) {
+            _pairing.Remove(sibling);
+        }
+    }
+}
+
+void ImageViewport::AddToDeleteHistory(std::vector<DeletedImage> batch) {
+    _deleteHistory.push_back(std::move(batch));
+    if (_deleteHistory.size() > _undoLimit) {
+        _deleteHistory.pop_front();
+    }
+}
+
+void ImageViewport::ShowNextLiveImage() {
+    const size_t next = _images.NextLive(_currentImageIdx);
+    const size_t prev = _images.PrevLive(_currentImageIdx);
+    if (next < _images.Size()) {
+        _currentImageIdx = static_cast<int64_t>(next);
+        UpdateNavDirection(1);
+        LoadCurrentImage();
+    } else if (prev < _images.Size()) {
+        // the last image was deleted, load the previous image
+        _currentImageIdx = static_cast<int64_t>(prev);
+        UpdateNavDirection(-1);
         LoadCurrentImage();
     }
+    // else there are no more images, `_images.Empty()` is true
+}
 
-    Reset();
+void ImageViewport::RemoveDeletedImages() {
+    // the current image (if any) ends up at its rank among the others
+    const size_t idx = _images.Empty() ? 0 : _images.LiveRank(_currentImageIdx);
+    _images.RemoveDeleted();
+    _currentImageIdx = static_cast<int64_t>(idx);
+}
+
+void ImageViewport::SortImages() {
+    if (_sortOrder == SortOrder::DATE_TAKEN) {
+        for (size_t i = 0; i < _images.Size(); ++i) {
+            _images.SetCaptureTime(i, GetCatalogCaptureTime(_images.GetFilename(i)));
+        }
+    }
+
+    _images.Sort([this](const size_t a, const size_t b) { return CompareImages(a, b); });
+}
+
+bool ImageViewport::CompareImages(const size_t a, const size_t b) const {
+    if (_sortOrder == SortOrder::DATE_TAKEN) {
+        const uint64_t timeA = _images.GetCaptureTime(a);
+        const uint64_t timeB = _images.GetCaptureTime(b);
+        if ((timeA == 0) != (timeB == 0))
+            return timeB == 0;
+        if (timeA != timeB)
+            return timeA < timeB;
+    }
+
+    return std::strcmp(_images.GetFilename(a), _images.GetFilename(b)) < 0;
+}
+
+uint64_t ImageViewport::GetCatalogCaptureTime(const char* filename) const {
+    ImageMetadata metadata{};
+    if (!_catalog.Get(filename, metadata) || metadata.exifErrCode != PARSE_EXIF_SUCCESS)
+        return 0;
+
+    return ImageList::PackCaptureTime(metadata.exif);
+}
+
+void ImageViewport::ResortImages() {
+    if (_images.Empty())
+        return;
+
+    const std::string currentPath = GetCurrentPath();
+    SortImages();
+
+    const size_t idx = _images.Find(currentPath);
+    _currentImageIdx = idx < _images.Size() ? static_cast<int64_t>(idx) : 0;
+
+    // the neighbors have changed
+    UpdateNavDirection(0);
+    PrefetchNeighbors();
+    CancelStaleRequests();
+}
+
+void ImageViewport::ToggleSortOrder() {
+    _sortOrder = _sortOrder == SortOrder::NAME ? SortOrder::DATE_TAKEN : SortOrder::NAME;
+    ResortImages();
+}
+
+std::string ImageViewport::GetCatalogModel(const char* filename) const {
+    ImageMetadata metadata{};
+    if (!_catalog.Get(filename, metadata) || metadata.exifErrCode != PARSE_EXIF_SUCCESS)
+        return "";
+
+    return metadata.exif.str(metadata.exif.Model);
+}
+
+void ImageViewport::ToggleCameraFilter() {
+    if (!_cameraFilter.empty()) {
+        _cameraFilter.clear();
+        ApplyFilter();
+        logger::info("Showing the images of all cameras");
+        return;
+    }
+
+    // the images listed after the filter would not be filtered
+    if (_images.Empty() || _scanning)
+        return;
+
+    _cameraFilter = GetCatalogModel(_images.GetFilename(_currentImageIdx));
+    if (_cameraFilter.empty()) {
+        logger::info("The camera of the current image is not known (yet)");
+        return;
+    }
+
+    ApplyFilter();
+    logger::info("Showing the images taken with: %s (%llu hidden)", _cameraFilter.c_str(),
+        static_cast<unsigned long long>(_filteredOut.Size()));
+}
+
+void ImageViewport::ApplyFilter() {
+    // the hidden images are filtered again, their camera might be known now
+    _images.Append(_filteredOut);
+    _filteredOut.Clear();
+
+    if (!_cameraFilter.empty()) {
+        std::vector<bool> hidden(_images.Size(), false);
+        for (size_t i = 0; i < _images.Size(); ++i) {
+            if (!_images.IsDeleted(i) && GetCatalogModel(_images.GetFilename(i)) != _cameraFilter) {
+                hidden[i] = true;
+                _filteredOut.PushBack(_images.GetPath(i));
+            }
+        }
+        _images.RemoveIf([&hidden](const size_t idx) { return hidden[idx]; });
+    }
+
+    ResortImages();
 }
 
 void ImageViewport::ZoomIn() {
@@ -198,81 +654,191 @@ void ImageViewport::Reset() {
 }
 
 void ImageViewport::NextImage() {
-    if (_currentImageIdx + 1 >= _images.size())
+    if (_images.Empty())
+        return;
+
+    // the deleted images are skipped
+    const size_t next = _images.NextLive(_currentImageIdx);
+    if (next >= _images.Size())
         return;
 
-    ++_currentImageIdx;
+    _currentImageIdx = static_cast<int64_t>(next);
+    UpdateNavDirection(1);
     LoadCurrentImage();
 }
 
 void ImageViewport::PrevImage() {
-    if (_currentImageIdx - 1 < 0)
+    if (_images.Empty())
+        return;
+
+    const size_t prev = _images.PrevLive(_currentImageIdx);
+    if (prev >= _images.Size())
         return;
 
-    --_currentImageIdx;
+    _currentImageIdx = static_cast<int64_t>(prev);
+    UpdateNavDirection(-1);
     LoadCurrentImage();
 }
 
 void ImageViewport::FirstImage() {
-    if (_images.empty())
+    if (_images.Empty())
         return;
 
-    _currentImageIdx = 0;
+    _currentImageIdx = static_cast<int64_t>(_images.NthLive(0));
+    UpdateNavDirection(0);
     LoadCurrentImage();
 }
 
 void ImageViewport::LastImage() {
-    if (_images.empty())
+    if (_images.Empty())
         return;
 
-    _currentImageIdx = _images.size() - 1;
+    _currentImageIdx = static_cast<int64_t>(_images.NthLive(_images.LiveCount() - 1));
+    UpdateNavDirection(0);
     LoadCurrentImage();
 }
 
+std::optional<ImageDetails> ImageViewport::GetCurrentImageInfo() const {
+    if (_images.Empty())
+        return std::nullopt;
+
+    ImageDetails details = _images.GetDetails(_currentImageIdx);
+    if (!_pairingReady)
+        return details;
+
+    bool hasImage = false;
+    bool hasRaw = false;
+    if (const std::vector<PairedFile>* files = _pairing.GetFiles(details.filepath)) {
+        for (const PairedFile& file : *files) {
+            hasImage = hasImage || file.kind == PairedFileKind::IMAGE;
+            hasRaw = hasRaw || file.kind == PairedFileKind::RAW;
+            if (file.kind != PairedFileKind::IMAGE && file.filepath != details.filepath) {
+                details.siblings.push_back(file.filepath.substr(file.filepath.find_last_of("\\/") + 1));
+            }
+        }
+    }
+
+    if (!_images.IsRaw(_currentImageIdx)) {
+        details.pairing = hasRaw ? PairingState::PAIRED : PairingState::NO_RAW;
+    } else {
+        details.pairing = hasImage ? PairingState::PAIRED : PairingState::ORPHAN_RAW;
+    }
+
+    return details;
+}
+
 void ImageViewport::DeleteImage() {
-    // TODO: switch to next or prev or no image after deleting
-    if (_images.empty())
+    if (_images.Empty())
         return;
 
-    if (!std::filesystem::exists(_info.trashDir)) {
-        std::filesystem::create_directory(_info.trashDir);
+    // move the files to the `trash directory` in the background
+    DeletedImage deleted{
+        .filepath = GetCurrentPath(),
+        .siblingPaths = GetSiblingPaths(GetCurrentPath()),
+        .trashDir = _info.trashDir,
+        .listIndex = static_cast<int64_t>(_images.LiveRank(_currentImageIdx)),
+    };
+    TrashFiles(deleted);
+    AddToDeleteHistory({ std::move(deleted) });
+
+    // the image is only marked as deleted (see `RemoveDeletedImages`), so
+    // the indices of the other images stay the same
+    _images.MarkDeleted(_currentImageIdx);
+    ShowNextLiveImage();
+    CalcDstRectangle();
+}
+
+void ImageViewport::DeleteOrphanRaws() {
+    if (!_pairingReady) {
+        logger::warn("The raw images are still being paired!");
+        return;
     }
 
-    // move the files to the `trash directory`
-    logger::log("moving: \"%s\" to \"%s\"",
-        GetCurrentImage().filepath.c_str(), _info.trashDir);
-    std::filesystem::rename(
-        GetCurrentImage().filepath,
-        _info.trashDir + GetCurrentImage().filename
-    );
+    const std::vector<std::vector<std::string>> orphans = _pairing.GetOrphanRaws();
+    if (orphans.empty())
+        return;
 
-    const std::string rawImageFileName =
-        GetCurrentImage().filenameNoExt + _info.rawImageExt;
-    const std::string rawImage = _info.rawImagePath + rawImageFileName;
+    // the orphan raw images in the image directory are in the list
+    std::unordered_map<std::string_view, size_t> rawIndices;
+    for (size_t i = 0; i < _images.Size(); ++i) {
+        if (_images.IsRaw(i) && !_images.IsDeleted(i)) {
+            rawIndices.emplace(_images.GetPath(i), i);
+        }
+    }
+
+    std::vector<DeletedImage> batch;
+    std::vector<size_t> listIndices;
+    batch.reserve(orphans.size());
+    for (const std::vector<std::string>& files : orphans) {
+        // the raw image in the list (if any) is the one put back by an undo
+        auto image = std::find_if(files.begin(), files.end(),
+            [&rawIndices](const std::string& file) { return rawIndices.count(file) != 0; });
+        if (image == files.end()) {
+            image = files.begin();
+        }
 
-    if (std::filesystem::exists(rawImage)) {
-        logger::log("moving: \"%s\" to \"%s\"", rawImage.c_str(), _info.trashDir);
-        std::filesystem::rename(rawImage, _info.trashDir + rawImageFileName);
+        DeletedImage& deleted = batch.emplace_back(DeletedImage{
+            .filepath = *image,
+            .siblingPaths = {},
+            .trashDir = _info.trashDir,
+            .listIndex = -1,
+        });
+        for (auto file = files.begin(); file != files.end(); ++file) {
+            if (file != image) {
+                deleted.siblingPaths.push_back(*file);
+            }
+        }
+
+        const auto listed = rawIndices.find(*image);
+        if (listed != rawIndices.end()) {
+            deleted.listIndex = static_cast<int64_t>(_images.LiveRank(listed->second));
+            listIndices.push_back(listed->second);
+        }
     }
 
-    _images.erase(_images.begin() + _currentImageIdx);
+    // queued at once, the trash queue syncs the directories once per batch
+    logger::info("Moving %llu orphan raw images to \"%s\"",
+        static_cast<unsigned long long>(batch.size()), _info.trashDir);
+    for (const DeletedImage& deleted : batch) {
+        TrashFiles(deleted);
+    }
+    AddToDeleteHistory(std::move(batch));
 
-    if (_currentImageIdx < _images.size() && !_images.empty()) {
-        // after image at `_currentImageIdx` has been removed 
-        // the index points to the next image
-        // so the next image will be loaded
-        LoadCurrentImage();
-    } else if (_currentImageIdx - 1 >= 0) {
-        // if after removing the image at current index
-        // the index is out of bounds, then decrement the index and load the image
-        --_currentImageIdx;
-        LoadCurrentImage();
-    } else {
-        // here there are no more images, so we reset `_currentImageIdx`
-        _currentImageIdx = 0;
+    const bool currentDeleted = std::find(listIndices.begin(), listIndices.end(),
+        static_cast<size_t>(_currentImageIdx)) != listIndices.end();
+    for (const size_t idx : listIndices) {
+        _images.MarkDeleted(idx);
     }
 
-    CalcDstRectangle();
+    if (currentDeleted) {
+        ShowNextLiveImage();
+        CalcDstRectangle();
+    } else if (!listIndices.empty()) {
+        // the neighbors might have changed
+        PrefetchNeighbors();
+        CancelStaleRequests();
+    }
+}
+
+void ImageViewport::UndoDelete() {
+    if (_deleteHistory.empty())
+        return;
+
+    // moved back after the pending moves to the trash directory, the images
+    // are shown again once they are back (see `RestoreImage`)
+    const std::vector<DeletedImage> batch = std::move(_deleteHistory.back());
+    _deleteHistory.pop_back();
+
+    for (const DeletedImage& deleted : batch) {
+        logger::log("restoring: \"%s\"", deleted.filepath.c_str());
+        _trash.PushRestore(deleted.filepath, deleted.trashDir, deleted.listIndex);
+        _pendingRestores[deleted.filepath] = deleted.listIndex >= 0;
+
+        for (const std::string& sibling : deleted.siblingPaths) {
+            _trash.PushRestore(sibling, deleted.trashDir, deleted.listIndex, true);
+            _pendingRestores[sibling] = false;
+        }
+    }
 }
 
 void ImageViewport::MoveCameraUsingMouse() {
@@ -282,7 +848,7 @@ void ImageViewport::MoveCameraUsingMouse() {
 }
 
 void ImageViewport::CalcDstRectangle() {
-    if (_images.empty())
+    if (_images.Empty())
         return;
 
     float w = static_cast<float>(_info.windowWidth);
@@ -299,8 +865,8 @@ void ImageViewport::CalcDstRectangle() {
         // the window is wider, so fit using window's height
         if (invAspectRatio < winAspectRatio) {
             // keep the original size if the window's height is bigger than the image's
-            if (_texture.width < _info.windowHeight) {
-                h = _texture.width;
+            if (_imageWidth < _info.windowHeight) {
+                h = _imageWidth;
             }
 
             _dstRectangle.height = h * invAspectRatio;
@@ -308,8 +874,8 @@ void ImageViewport::CalcDstRectangle() {
         }
         // the image is wider, so fit using window's width
         else {
-            if (_texture.height < _info.windowWidth) {
-                w = _texture.height;
+            if (_imageHeight < _info.windowWidth) {
+                w = _imageHeight;
             }
 
             _dstRectangle.height = w;
@@ -319,8 +885,8 @@ void ImageViewport::CalcDstRectangle() {
         // the window is wider, so fit using window's height
         if (_aspectRatio < winAspectRatio) {
             // keep the original size if the window's height is bigger than the image's
-            if (_texture.height < _info.windowHeight) {
-                h = _texture.height;
+            if (_imageHeight < _info.windowHeight) {
+                h = _imageHeight;
             }
 
             _dstRectangle.width = h * _aspectRatio;
@@ -328,8 +894,8 @@ void ImageViewport::CalcDstRectangle() {
         }
         // the image is wider, so fit using window's width
         else {
-            if (_texture.width < _info.windowWidth) {
-                w = _texture.width;
+            if (_imageWidth < _info.windowWidth) {
+                w = _imageWidth;
             }
 
             _dstRectangle.width = w;
@@ -339,120 +905,267 @@ void ImageViewport::CalcDstRectangle() {
 }
 
 void ImageViewport::LoadCurrentImage() {
-    if (_images.empty()) {
+    if (_images.Empty()) {
         return;
     }
 
-    Timer t{ "Loading image \"" + GetCurrentImage().filepath + '"' };
-
-    // read file
-    FILE* file;
-    unsigned char* imageData = nullptr; // image data
-    uint64_t imageDataSize = 0;
-    const char* filepath = GetCurrentImage().filepath.c_str();
-    file = fopen(filepath, "rb");
-    if (file == nullptr) {
-        logger::error("Failed to load file: %s", filepath);
-        imageDataSize = 0;
-        // TODO: handle failed to load (show a toast msg)
-        std::exit(-1);
+    const std::string filepath = GetCurrentPath();
+    const CachedTexture* cached =
+        _textures.Get(filepath, GetFileModTime(filepath.c_str()));
+    if (cached != nullptr) {
+        ShowImage(*cached);
+    } else if (_pendingRequests.count(filepath) == 0) {
+        _pendingRequests[filepath] = _loader.Request(filepath, true, GetDisplaySize(), true);
+    } else {
+        // already requested by the prefetcher, decode it before the others
+        _loader.Prioritize(filepath);
     }
 
-    fseek(file, 0, SEEK_END);
-    imageDataSize = ftell(file);
-    rewind(file);
-    imageData = new unsigned char[imageDataSize];
-    if (fread(imageData, sizeof(unsigned char), imageDataSize, file) != imageDataSize) {
-        logger::error("Failed to read file: %s", filepath);
-        delete[] imageData;
-        imageDataSize = 0;
-        // TODO: handle failed to load (show a toast msg)
-        std::exit(-1);
+    // while skimming through the images only the image we stop on is
+    // loaded, so that the time taken depends on where we stop and not on
+    // how many images we skipped
+    const double now = GetTime();
+    const bool skimming = now - _lastNavTime < _skimInterval;
+    _lastNavTime = now;
+    if (skimming) {
+        _prefetchPaths.clear();
+        _prefetchDue = true;
+    } else {
+        PrefetchNeighbors();
     }
 
-    fclose(file);
+    CancelStaleRequests();
+}
 
-    int comp = 0; // image components (R, G, B, A)
-    Image image{};
+int ImageViewport::GetDisplaySize() const {
+    return static_cast<int>(std::max(_info.windowWidth, _info.windowHeight));
+}
 
-    image.data = stbi_load_from_memory(
-        imageData,
-        imageDataSize,
-        &image.width,
-        &image.height,
-        &comp,
-        0
-    );
+void ImageViewport::RequestFullResolution() {
+    if (!_displayedDownscaled || _texture.id == 0 || _fullResolutionPath == _displayedPath)
+        return;
 
-    if (image.data == nullptr)
-        return; // TODO: handle this case
+    // screen pixels per texel
+    const float scale = _camera.zoom * _dstRectangle.width / static_cast<float>(_texture.width);
+    if (scale <= 1.0f)
+        return;
 
-    image.mipmaps = 1;
-    if (comp == 1) {
-        image.format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE;
-    } else if (comp == 2) {
-        image.format = PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA;
-    } else if (comp == 3) {
-        image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8;
-    } else if (comp == 4) {
-        image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    // without a preview, the downscaled image stays on screen until it is decoded
+    _fullResolutionPath = _displayedPath;
+    _pendingRequests[_displayedPath] = _loader.Request(_displayedPath, true, 0, false);
+}
+
+void ImageViewport::CancelStaleRequests() {
+    std::unordered_set<std::string> keep{ _prefetchPaths };
+    if (!_images.Empty()) {
+        keep.insert(GetCurrentPath());
     }
 
-    // reset image rotation and
-    // change it later if orientation (exif data) of image is not '1'
-    _originalRotation = ImageRotation::NONE;
-    _imageRotation = ImageRotation::NONE;
+    _loader.Retain(keep);
 
-    // reset the camera
-    Reset();
+    // cancelled in-flight requests still get returned by the loader, they are
+    // requested again in `Update` if we navigate back to them in the meantime
+    for (auto it = _pendingRequests.begin(); it != _pendingRequests.end();) {
+        if (keep.count(it->first) == 0) {
+            it = _pendingRequests.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
 
-    tinyexif::EXIFInfo exifInfo;
-    const int errCode = exifInfo.parseFrom(
-        const_cast<const unsigned char*>(imageData),
-        imageDataSize
-    );
+void ImageViewport::PrefetchNeighbors() {
+    _prefetchPaths.clear();
+    if (_images.Empty())
+        return;
 
-    // check for error when parsing EXIF data
-    if (errCode == PARSE_EXIF_ERROR_NO_EXIF) {
-        logger::info("EXIF data not found!");
-    } else if (errCode == PARSE_EXIF_ERROR_NO_JPEG) {
-        logger::warn("Cannot parse EXIF data for non-JPEG images!");
-    } else if (errCode == PARSE_EXIF_ERROR_UNKNOWN_BYTEALIGN) {
-        logger::error("Error reading EXIF data (UNKNOWN BYTE ALIGNMENT)!");
-    } else if (errCode == PARSE_EXIF_ERROR_CORRUPT) {
-        logger::error("Error reading EXIF data (DATA CORRUPTED)!");
-    }
-    // no error
-    else {
-        GetCurrentImage().exifInfo = exifInfo;
-
-        // rotate the images if the orientation is not correct
-        // ref: https://jdhao.github.io/2019/07/31/image_rotation_exif_info/
-        if (exifInfo.Orientation == 8) {
-            _originalRotation = ImageRotation::RIGHT_270;
-            _imageRotation = _originalRotation;
-        } else if (exifInfo.Orientation == 3) {
-            _originalRotation = ImageRotation::RIGHT_180;
-            _imageRotation = _originalRotation;
-        } else if (exifInfo.Orientation == 6) {
-            _originalRotation = ImageRotation::RIGHT_90;
-            _imageRotation = _originalRotation;
+    const int64_t forward = _navDirection >= 0
+        ? std::min(_prefetchMin + _navStreak, _prefetchMax)
+        : _prefetchMin;
+    const int64_t backward = _navDirection < 0
+        ? std::min(_prefetchMin + _navStreak, _prefetchMax)
+        : _prefetchMin;
+
+    // nearest images first, the deleted images are skipped
+    std::vector<std::string> requested;
+    size_t ahead = static_cast<size_t>(_currentImageIdx);
+    size_t behind = static_cast<size_t>(_currentImageIdx);
+    for (int64_t dist = 1; dist <= std::max(forward, backward); ++dist) {
+        if (dist <= forward && ahead < _images.Size()) {
+            ahead = _images.NextLive(ahead);
+        }
+        if (dist <= backward && behind < _images.Size()) {
+            behind = _images.PrevLive(behind);
         }
 
-        CalcDstRectangle();
+        for (const size_t idx : { dist <= forward ? ahead : _images.Size(),
+                                  dist <= backward ? behind : _images.Size() }) {
+            if (idx >= _images.Size())
+                continue;
+
+            const std::string filepath = _images.GetPath(idx);
+            if (!_prefetchPaths.insert(filepath).second || _pendingRequests.count(filepath) != 0)
+                continue;
+            // also uploads the images that are only cached in RAM
+            if (_textures.Get(filepath, GetFileModTime(filepath.c_str()), false) != nullptr)
+                continue;
+
+            requested.push_back(filepath);
+        }
+    }
+
+    // read from disk as one batch, not by each worker on its own (before
+    // the workers get the requests)
+    _loader.Readahead(requested);
+    for (const std::string& filepath : requested) {
+        _pendingRequests[filepath] = _loader.Request(filepath, false, GetDisplaySize());
     }
+}
+
+void ImageViewport::UpdateNavDirection(const int32_t direction) {
+    if (direction != 0 && direction == _navDirection) {
+        ++_navStreak;
+    } else {
+        _navStreak = 0;
+    }
+
+    _navDirection = direction;
+}
 
-    _texture = LoadTextureFromImage(image);
+void ImageViewport::ShowImage(const CachedTexture& cached) {
+    // the previous texture stays on screen until the upload is done
+    if (cached.uploading) {
+        _uploadingPath = cached.filepath;
+        _uploadingModTime = cached.modTime;
+        return;
+    }
+    _uploadingPath.clear();
+
+    // the camera is not reset when the preview of this image is on screen
+    const bool replacesPreview =
+        _previewTexture.id != 0 && _previewPath == cached.filepath;
+    // the full resolution of the image on screen
+    const bool replacesImage = _displayedPath == cached.filepath;
+    if (!replacesImage) {
+        _fullResolutionPath.clear();
+    }
+
+    ApplyEXIFInfo(cached.exif);
+
+    _texture = cached.texture;
+    _textures.Pin(cached);
+    _displayedPath = cached.filepath;
+    _displayedDownscaled = cached.downscaled;
+    UnloadPreview();
+
+    // the pixels stay in the cache while the entry is pinned
+    int textureWidth = _texture.width;
+    int textureHeight = _texture.height;
+    if (cached.tiled) {
+        _tiles.SetImage(cached.image, _info.textureFiltering);
+        textureWidth = cached.image.width;
+        textureHeight = cached.image.height;
+    } else {
+        _tiles.Clear();
+    }
+
+    _imageWidth = cached.imageWidth > 0 ? cached.imageWidth : textureWidth;
+    _imageHeight = cached.imageHeight > 0 ? cached.imageHeight : textureHeight;
     _aspectRatio =
-        static_cast<float>(image.width) / static_cast<float>(image.height);
+        static_cast<float>(_imageWidth) / static_cast<float>(_imageHeight);
     _srcRectangle = {
         .x = 0.0f,
         .y = 0.0f,
-        .width = static_cast<float>(image.width),
-        .height = static_cast<float>(image.height),
+        .width = static_cast<float>(textureWidth),
+        .height = static_cast<float>(textureHeight),
     };
 
-    delete[] imageData;
-    UnloadImage(image);
-    CalcDstRectangle();
+    if (replacesPreview || replacesImage) {
+        CalcDstRectangle();
+    } else {
+        // reset the camera (also applies `_originalRotation`)
+        Reset();
+    }
+}
+
+void ImageViewport::ShowUploadedImage() {
+    if (_uploadingPath.empty())
+        return;
+
+    // navigated away in the meantime
+    if (_images.Empty() || _uploadingPath != GetCurrentPath()) {
+        _uploadingPath.clear();
+        return;
+    }
+
+    const CachedTexture* cached = _textures.Get(_uploadingPath, _uploadingModTime, false);
+    if (cached == nullptr) {
+        _uploadingPath.clear();
+    } else if (!cached->uploading) {
+        ShowImage(*cached);
+    }
+}
+
+void ImageViewport::ShowPreview(const LoadedImage& preview) {
+    ApplyEXIFInfo(preview.exif);
+
+    UnloadPreview();
+    _tiles.Clear();
+    _previewTexture = LoadTextureFromImage(preview.image);
+    // thumbnails are scaled up, there are no mipmap levels to blend
+    SetTextureFilter(_previewTexture, TEXTURE_FILTER_BILINEAR);
+    SetTextureWrap(_previewTexture, TEXTURE_WRAP_CLAMP);
+    _previewPath = preview.filepath;
+    _texture = _previewTexture;
+    _displayedPath.clear();
+
+    const float thumbWidth = static_cast<float>(_previewTexture.width);
+    const float thumbHeight = static_cast<float>(_previewTexture.height);
+    _imageWidth = preview.imageWidth > 0 ? preview.imageWidth : _previewTexture.width;
+    _imageHeight = preview.imageHeight > 0 ? preview.imageHeight : _previewTexture.height;
+    _aspectRatio =
+        static_cast<float>(_imageWidth) / static_cast<float>(_imageHeight);
+
+    // thumbnails are usually 160x120, so images with a different aspect ratio
+    // are padded with black bars, crop them out
+    if (thumbWidth / thumbHeight > _aspectRatio) {
+        const float width = thumbHeight * _aspectRatio;
+        _srcRectangle = { (thumbWidth - width) * 0.5f, 0.0f, width, thumbHeight };
+    } else {
+        const float height = thumbWidth / _aspectRatio;
+        _srcRectangle = { 0.0f, (thumbHeight - height) * 0.5f, thumbWidth, height };
+    }
+
+    // reset the camera (also applies `_originalRotation`)
+    Reset();
+}
+
+void ImageViewport::UnloadPreview() {
+    if (_previewTexture.id != 0) {
+        UnloadTexture(_previewTexture);
+    }
+
+    _previewTexture = Texture2D{};
+    _previewPath.clear();
+}
+
+void ImageViewport::ApplyEXIFInfo(const std::optional<tinyexif::EXIFRecord>& exif) {
+    // reset image rotation and
+    // change it later if orientation (exif data) of image is not '1'
+    _originalRotation = ImageRotation::NONE;
+
+    if (!exif.has_value())
+        return;
+
+    _images.SetEXIF(_currentImageIdx, exif.value());
+
+    // rotate the images if the orientation is not correct
+    // ref: https://jdhao.github.io/2019/07/31/image_rotation_exif_info/
+    if (exif->Orientation == 8) {
+        _originalRotation = ImageRotation::RIGHT_270;
+    } else if (exif->Orientation == 3) {
+        _originalRotation = ImageRotation::RIGHT_180;
+    } else if (exif->Orientation == 6) {
+        _originalRotation = ImageRotation::RIGHT_90;
+    }
 }
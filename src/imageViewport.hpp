@@ -1,9 +1,21 @@
 #pragma once
 
 #include <vector>
+#include <string>
+#include <unordered_set>
+#include <unordered_map>
+#include <deque>
 #include <cstdint>
 #include "raylib.h"
 #include "types.hpp"
+#include "imageLoader.hpp"
+#include "textureCache.hpp"
+#include "tiledTexture.hpp"
+#include "metadataCatalog.hpp"
+#include "directoryStream.hpp"
+#include "imageList.hpp"
+#include "trashQueue.hpp"
+#include "pairingIndex.hpp"
 
 
 struct ImageViewportInfo {
@@ -14,6 +26,19 @@ struct ImageViewportInfo {
 
     uint64_t windowWidth;
     uint64_t windowHeight;
+
+    uint64_t textureCacheSize; // in bytes
+    uint64_t imageCacheSize; // in bytes
+
+    TextureFiltering textureFiltering;
+};
+
+// a delete that can be undone, see `ImageViewport::UndoDelete`
+struct DeletedImage {
+    std::string filepath;
+    std::vector<std::string> siblingPaths; // raw and sidecar files (might not exist)
+    std::string trashDir; // where the files were moved
+    int64_t listIndex; // position of the image in the list, -1 if it was not in the list
 };
 
 class ImageViewport {
@@ -28,6 +53,19 @@ public:
     void Init();
     void Cleanup();
     void Draw();
+
+    /**
+     * Uploads the images decoded in the background.
+     * This function should be called once every frame (before `Draw`)
+     */
+    void Update();
+
+    /**
+     * @returns true if nothing on screen changes until there is input (no
+     *          images being listed, decoded, prefetched or moved)
+     */
+    [[nodiscard]] bool IsIdle() const;
+
     void Resize(const uint64_t width, const uint64_t height);
 
     /**
@@ -49,7 +87,9 @@ public:
     void LoadFilesFromList(const FilePathList& files);
 
     /**
-      * Loads images using directory path
+      * Loads images using directory path. The directory is listed in the
+      * background, the images are added in `Update` as they are found and
+      * the first one is shown right away.
       * @param `path` - path of the directory the images are in
       */
     void LoadFilesFromDir(const char* path);
@@ -65,19 +105,43 @@ public:
     void FirstImage();
     void LastImage();
     void DeleteImage(); // delete the image and raw image (if found)
+    void UndoDelete(); // restore the last deleted images and their raw images
+    void DeleteOrphanRaws(); // delete the raw images that have no jpg/png
+    void ToggleSortOrder(); // sort by name or by date taken
+    // show only the images taken with the camera of the current image, or all of them
+    void ToggleCameraFilter();
     void MoveCameraUsingMouse();
 
-    [[nodiscard]] inline std::optional<ImageDetails> GetCurrentImageInfo() const {
-        if (_images.empty())
-            return std::nullopt;
+    // details of the current image with its raw and sidecar files
+    [[nodiscard]] std::optional<ImageDetails> GetCurrentImageInfo() const;
 
-        return _images[_currentImageIdx];
+    [[nodiscard]] inline ImageCounter GetImageCounter() const {
+        return ImageCounter{
+            .index = _images.Empty() ? 0 : _images.LiveRank(_currentImageIdx),
+            .count = _images.LiveCount(),
+            .scanning = _scanning,
+        };
     }
 
+    // bytes allocated by the image list
+    [[nodiscard]] inline size_t GetImageListMemory() const { return _images.GetMemoryUsage(); }
+    [[nodiscard]] inline CacheStats GetCacheStats() const { return _textures.GetStats(); }
+    // VRAM used by the tiles of the image on screen
+    [[nodiscard]] inline uint64_t GetTileTextureBytes() const { return _tiles.GetTextureBytes(); }
+    [[nodiscard]] inline CatalogProgress GetCatalogProgress() const { return _catalog.GetProgress(); }
+    [[nodiscard]] inline SortOrder GetSortOrder() const { return _sortOrder; }
+    // EXIF camera model that the images are filtered by, empty if they are not
+    [[nodiscard]] inline const std::string& GetCameraFilter() const { return _cameraFilter; }
+    [[nodiscard]] inline TrashStatus GetTrashStatus() const { return _trash.GetStatus(); }
+    [[nodiscard]] inline TextureFiltering GetTextureFiltering() const { return _info.textureFiltering; }
+    // `GetTime` of the last move to another image
+    [[nodiscard]] inline double GetLastNavTime() const { return _lastNavTime; }
+
     inline void UpdateImagePath(const char* path) { _info.imagePath = path; }
     inline void UpdateRawImagePath(const char* path) { _info.rawImagePath = path; }
     inline void UpdateTrashDir(const char* path) { _info.trashDir = path; }
     inline void UpdateRawImageExt(const char* ext) { _info.rawImageExt = ext; }
+    void UpdateTextureFiltering(const TextureFiltering filtering);
 
 
 private:
@@ -89,32 +153,218 @@ private:
     void CalcDstRectangle();
 
     /**
-     * Loads image in the current index from `_images`
+     * Removes the raw images that have a jpg/png with the same name next to
+     * them, so that only raw-only images are shown as raw previews.
+     */
+    void RemovePairedRawImages();
+
+    /**
+     * Drops the images that have been deleted from `_images` (linear),
+     * `_currentImageIdx` is updated
+     */
+    void RemoveDeletedImages();
+
+    /**
+     * @returns paths of the raw and sidecar files of the image (from the
+     *          pairing index, or the raw image path from the config while
+     *          the directory is being listed)
+     */
+    [[nodiscard]] std::vector<std::string> GetSiblingPaths(const std::string& filepath) const;
+
+    // queues moving the files to the trash directory
+    void TrashFiles(const DeletedImage& deleted);
+
+    // keeps the last `_undoLimit` deletes (a batch is undone at once)
+    void AddToDeleteHistory(std::vector<DeletedImage> batch);
+
+    /**
+     * Shows the image after the current one (that has been deleted), or the
+     * one before it if it was the last
+     */
+    void ShowNextLiveImage();
+
+    /**
+     * Puts an image that has been moved back from the trash directory in
+     * `_images` again (at its position in the sort order) and shows it
+     * @param `filepath` - path of the restored image
+     */
+    void RestoreImage(const std::string& filepath);
+
+    /**
+     * Adds the images listed by `_stream` since the last frame. They are
+     * merged in name order and the current image stays on screen (its index
+     * changes). Opens the catalog once the directory has been listed.
+     */
+    void PollDirectoryStream();
+
+    /**
+     * Merges a batch from `_stream` into `_images` (in name order) and drops
+     * the raw images that are paired with a jpg/png
+     * @param `batch` - images found since the last frame (gets sorted)
+     */
+    void AddImages(ImageList& batch);
+
+    /**
+     * Sorts `_images` by `_sortOrder`. Images without a capture time in the
+     * catalog (not indexed yet or no EXIF data) go last, in name order.
+     * Does not update `_currentImageIdx`.
+     */
+    void SortImages();
+
+    // `SortImages` order: returns true if image `a` goes before image `b`
+    [[nodiscard]] bool CompareImages(const size_t a, const size_t b) const;
+
+    // packed capture time of the file in the catalog, 0 if it is not known
+    [[nodiscard]] uint64_t GetCatalogCaptureTime(const char* filename) const;
+
+    /**
+     * Sorts `_images` again (eg: when the catalog got more entries)
+     * while keeping the current image on screen
+     */
+    void ResortImages();
+
+    // EXIF camera model of the file in the catalog, empty if it is not known
+    [[nodiscard]] std::string GetCatalogModel(const char* filename) const;
+
+    /**
+     * Moves the images that do not match `_cameraFilter` (or whose camera is
+     * not known) to `_filteredOut` and the ones that match back to
+     * `_images`, then sorts them again. The deleted images are left as is.
+     */
+    void ApplyFilter();
+
+    /**
+     * Drops the queued and in-flight image requests.
+     * The cached textures are kept.
+     */
+    void CancelLoading();
+
+    /**
+     * Shows the image in the current index from `_images` if it has already
+     * been prefetched, otherwise requests it to be decoded in the background.
+     * The current texture is kept on screen until the decoded image is
+     * uploaded in `Update`. Also prefetches the neighboring images.
      */
     void LoadCurrentImage();
 
-    inline const ImageDetails& GetCurrentImage() const { 
-        return _images[_currentImageIdx];
-    }
+    /**
+     * Requests the images around `_currentImageIdx` to be decoded in the
+     * background. More images are prefetched in the direction of navigation.
+     */
+    void PrefetchNeighbors();
+
+    // max width and height of the images on screen (either way rotated)
+    [[nodiscard]] int GetDisplaySize() const;
+
+    /**
+     * Requests the image on screen at full resolution once it is zoomed in
+     * past the resolution it was decoded at
+     */
+    void RequestFullResolution();
 
-    inline ImageDetails& GetCurrentImage() { 
-        return _images[_currentImageIdx];
+    /**
+     * Cancels the requests for the images that are neither the current image
+     * nor in the prefetch window
+     */
+    void CancelStaleRequests();
+
+    /**
+     * Keeps track of the direction the user is navigating in
+     * @param `direction` - +1 (next), -1 (previous) or 0 (jump)
+     */
+    void UpdateNavDirection(const int32_t direction);
+
+    /**
+     * Displays the cached texture and applies the EXIF orientation. If the
+     * texture is still being uploaded, it is displayed by
+     * `ShowUploadedImage` once it is done.
+     * @param `cached` - entry from `_textures`
+     */
+    void ShowImage(const CachedTexture& cached);
+
+    // displays the current image once its texture is uploaded
+    void ShowUploadedImage();
+
+    /**
+     * Displays the embedded EXIF thumbnail (upscaled to the size of the
+     * image) until the full image is decoded
+     * @param `preview` - thumbnail decoded by `_loader`
+     */
+    void ShowPreview(const LoadedImage& preview);
+    void UnloadPreview();
+
+    /**
+     * Stores the EXIF data of the current image and
+     * sets `_originalRotation` from its orientation
+     */
+    void ApplyEXIFInfo(const std::optional<tinyexif::EXIFRecord>& exif);
+
+    inline const char* GetCurrentPath() const {
+        return _images.GetPath(_currentImageIdx);
     }
 
 
 private:
     constexpr static float _zoomVal = 0.2f;
     constexpr static int32_t _rotationVal = 90;
+    constexpr static int64_t _prefetchMin = 1; // images prefetched in each direction
+    constexpr static int64_t _prefetchMax = 4; // images prefetched in the direction of navigation
+    // navigating faster than this (in seconds) only loads the current image,
+    // the neighbors are prefetched once the navigation stops
+    constexpr static double _skimInterval = 0.15;
+    // interval (in seconds) between merging the images listed in the background
+    constexpr static double _scanPollInterval = 0.1;
+    // time (in seconds) without navigating before the deleted images are
+    // dropped from `_images`
+    constexpr static double _compactDelay = 2.0;
+    constexpr static size_t _undoLimit = 100; // deletes that can be undone
 
     ImageViewportInfo _info; // holds data to instantiate ImageViewport object
     int64_t _currentImageIdx;
     Rectangle _dstRectangle; // to render the image texture
     Camera2D _camera;
-    std::vector<ImageDetails> _images;
+    ImageList _images;
     ImageRotation _imageRotation;
     ImageRotation _originalRotation;
 
-    Texture2D _texture{};
+    DirectoryStream _stream;
+    bool _scanning = false; // `_stream` is still listing the directory
+    std::string _scanDirectory; // absolute path of the directory being listed
+    double _lastScanPoll = 0.0;
+    bool _scanHasRaws = false; // raw images were listed, they need to be paired
+
+    MetadataCatalog _catalog;
+    TrashQueue _trash; // moves the deleted images
+    std::deque<std::vector<DeletedImage>> _deleteHistory; // most recent last
+    // files being moved back (-> whether the file is in `_images`)
+    std::unordered_map<std::string, bool> _pendingRestores;
+    PairingIndex _pairing; // of the listed directory
+    bool _pairingReady = false; // the directory has been listed
+    SortOrder _sortOrder = SortOrder::NAME;
+    std::string _cameraFilter; // EXIF camera model, empty to show all the images
+    ImageList _filteredOut; // hidden by `_cameraFilter`, not sorted
+
+    ImageLoader _loader;
+    TextureCache _textures;
+    // requested but not loaded yet (file path -> latest request id)
+    std::unordered_map<std::string, uint64_t> _pendingRequests;
+    std::unordered_set<std::string> _prefetchPaths; // images in the prefetch window
+    int32_t _navDirection = 0;
+    int64_t _navStreak = 0; // number of consecutive moves in `_navDirection`
+    double _lastNavTime = 0.0;
+    bool _prefetchDue = false; // prefetch once the user stops skimming
+
+    Texture2D _texture{}; // texture on screen (owned by `_textures` or the preview)
+    TiledTexture _tiles; // of the image on screen if it is too large for `_texture`
+    std::string _displayedPath; // image whose full texture is on screen
+    bool _displayedDownscaled = false; // decoded at the display size
+    std::string _fullResolutionPath; // requested at full resolution (once per image)
+    std::string _uploadingPath; // current image, shown once its texture is uploaded
+    long _uploadingModTime = 0;
+    Texture2D _previewTexture{}; // EXIF thumbnail shown while decoding
+    std::string _previewPath;
     Rectangle _srcRectangle{ 0.0f, 0.0f, 0.0f, 0.0f };
     float _aspectRatio = 0.0f;
+    int _imageWidth = 0; // size of the image on screen (not of the texture)
+    int _imageHeight = 0;
 };
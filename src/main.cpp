@@ -12,12 +12,6 @@
 //           - so that you can only hide the windows that are visible
 // TODO: zoom in from where the mouse cursor is
 
-// TODO: multithreading
-//       - load images in batches in the background and clear
-//         the images accordingly
-//       - store loaded images in a stack-like data structure tht will only store
-//         a number of images, and when full will overwrite
-//         the older images (use indices)
 // TODO: hot reloading
 // TODO: CTRL+C to copy image and CTRL+SHIFT+C to copy path
 // TODO: drag the image to copy the image
@@ -0,0 +1,202 @@
+#include "mappedFile.hpp"
+
+#include <cerrno>
+#include <algorithm>
+#include "bufferPool.hpp"
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+#if defined(__linux__)
+    #include <sys/vfs.h>
+#endif
+
+
+namespace {
+
+#if defined(__linux__)
+
+// page faults on network and FUSE file systems are synchronous round trips
+bool IsMmapSlow(const int fd) {
+    struct statfs fs{};
+    if (fstatfs(fd, &fs) != 0)
+        return false;
+
+    constexpr unsigned long slowFileSystems[] = {
+        0x6969, // NFS
+        0x517B, // SMB
+        0xFF534D42, // CIFS
+        0xFE534D42, // SMB2
+        0x65735546, // FUSE
+        0x01021997, // 9P (eg: WSL)
+        0x00C36400, // Ceph
+    };
+    const unsigned long type = static_cast<unsigned long>(fs.f_type);
+    return std::find(std::begin(slowFileSystems), std::end(slowFileSystems), type)
+        != std::end(slowFileSystems);
+}
+
+#elif !defined(_WIN32)
+
+bool IsMmapSlow(const int) {
+    return false;
+}
+
+#endif
+
+} // namespace
+
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const char* filepath) {
+    Close();
+
+#if defined(_WIN32)
+    _file = fopen(filepath, "rb");
+    if (_file == nullptr)
+        return false;
+
+    _fseeki64(_file, 0, SEEK_END);
+    const int64_t size = _ftelli64(_file);
+    _fileSize = size > 0 ? static_cast<uint64_t>(size) : 0;
+#else
+    _fd = open(filepath, O_RDONLY | O_CLOEXEC);
+    if (_fd < 0)
+        return false;
+
+    struct stat st{};
+    if (fstat(_fd, &st) != 0) {
+        Close();
+        return false;
+    }
+    _fileSize = st.st_size > 0 ? static_cast<uint64_t>(st.st_size) : 0;
+
+    if (_fileSize > 0 && !IsMmapSlow(_fd)) {
+        void* mapping = mmap(nullptr, _fileSize, PROT_READ, MAP_PRIVATE, _fd, 0);
+        // read with pread instead
+        if (mapping != MAP_FAILED) {
+            _contents = static_cast<unsigned char*>(mapping);
+        }
+    }
+#endif
+
+    if (_fileSize == 0) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::Adopt(unsigned char* contents, const uint64_t size) {
+    Close();
+    _contents = contents;
+    _adopted = true;
+    _fileSize = size;
+}
+
+void MappedFile::Close() {
+    ReleaseRange();
+    if (_adopted) {
+        BufferPool::Get().Free(_contents);
+        _contents = nullptr;
+        _adopted = false;
+    }
+
+#if defined(_WIN32)
+    if (_file != nullptr) {
+        fclose(_file);
+        _file = nullptr;
+    }
+#else
+    if (_contents != nullptr) {
+        munmap(_contents, _fileSize);
+        _contents = nullptr;
+    }
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+#endif
+
+    _fileSize = 0;
+}
+
+bool MappedFile::SetRange(const uint64_t offset, const uint64_t size) {
+    ReleaseRange();
+    if (offset > _fileSize || size > _fileSize - offset)
+        return false;
+
+    _offset = offset;
+    _size = size;
+
+    if (_contents != nullptr) {
+        _data = _contents + offset;
+#if !defined(_WIN32)
+        if (!_adopted) {
+            // madvise needs a page aligned address
+            const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+            const uint64_t start = offset / pageSize * pageSize;
+            madvise(_contents + start, offset + size - start, MADV_SEQUENTIAL);
+            madvise(_contents + start, offset + size - start, MADV_WILLNEED);
+        }
+#endif
+        return true;
+    }
+
+    _buffer = static_cast<unsigned char*>(BufferPool::Get().Allocate(size));
+    _data = _buffer;
+    return _buffer != nullptr;
+}
+
+bool MappedFile::Read(const uint64_t begin, const uint64_t end) {
+    if (begin > end || end > _size || _data == nullptr)
+        return false;
+    if (_contents != nullptr)
+        return true;
+
+    return ReadAt(_offset + begin, _buffer + begin, end - begin);
+}
+
+bool MappedFile::ReadAt(const uint64_t offset, void* dst, const uint64_t size) const {
+    if (offset > _fileSize || size > _fileSize - offset)
+        return false;
+
+    if (_contents != nullptr) {
+        std::copy_n(_contents + offset, size, static_cast<unsigned char*>(dst));
+        return true;
+    }
+
+#if defined(_WIN32)
+    return _fseeki64(_file, static_cast<int64_t>(offset), SEEK_SET) == 0
+        && fread(dst, sizeof(unsigned char), size, _file) == size;
+#else
+    unsigned char* out = static_cast<unsigned char*>(dst);
+    uint64_t done = 0;
+    while (done < size) {
+        const ssize_t count = pread(_fd, out + done, size - done, static_cast<off_t>(offset + done));
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+
+        done += static_cast<uint64_t>(count);
+    }
+
+    return true;
+#endif
+}
+
+void MappedFile::ReleaseRange() {
+    BufferPool::Get().Free(_buffer);
+    _buffer = nullptr;
+    _data = nullptr;
+    _offset = 0;
+    _size = 0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+
+/**
+ * Read-only view of an image file for the decoders. The file is memory
+ * mapped, so the decoders and the EXIF parser read straight from the page
+ * cache without copying it to the heap, and viewing the image again reuses
+ * the cached pages.
+ *
+ * On file systems where mmap is slow or unsafe (network and FUSE file
+ * systems), if the mapping fails, and on Windows, the range is read with
+ * `pread` into a buffer from `BufferPool` instead.
+ *
+ * A mapped file must not be truncated while it is open (reading past the new
+ * end raises SIGBUS), the images are only replaced by renaming.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    // @returns false if the file could not be opened or is empty
+    bool Open(const char* filepath);
+
+    /**
+     * Uses the contents of a file that was already read (see `BatchReader`)
+     * instead of opening it
+     * @param `contents` - the whole file, allocated from `BufferPool` and
+     *                     owned by this from now on
+     */
+    void Adopt(unsigned char* contents, const uint64_t size);
+
+    void Close();
+
+    /**
+     * Selects the part of the file that `Read` reads and `GetData` points to.
+     * A mapped range is read ahead by the kernel (MADV_SEQUENTIAL and
+     * MADV_WILLNEED), otherwise a buffer is allocated for it.
+     * @returns false if the range is not in the file
+     */
+    bool SetRange(const uint64_t offset, const uint64_t size);
+
+    /**
+     * Reads `[begin, end)` of the range (relative to its start). Does not
+     * copy anything for mapped files, the pages are read when the decoder
+     * touches them.
+     * @returns false if the file could not be read
+     */
+    bool Read(const uint64_t begin, const uint64_t end);
+
+    /**
+     * Copies bytes from anywhere in the file (eg: the IFDs of raw files)
+     * @returns false if they are not in the file or could not be read
+     */
+    bool ReadAt(const uint64_t offset, void* dst, const uint64_t size) const;
+
+    // start of the range, valid until the next `SetRange` or `Close`
+    [[nodiscard]] inline const unsigned char* GetData() const { return _data; }
+    [[nodiscard]] inline uint64_t GetSize() const { return _fileSize; }
+    [[nodiscard]] inline bool IsMapped() const { return _contents != nullptr && !_adopted; }
+
+private:
+    // frees the buffer of the range (if it is not mapped)
+    void ReleaseRange();
+
+private:
+#if defined(_WIN32)
+    FILE* _file = nullptr;
+#else
+    int _fd = -1;
+#endif
+    uint64_t _fileSize = 0;
+    // whole file (mapped or adopted), nullptr if the ranges are read
+    unsigned char* _contents = nullptr;
+    bool _adopted = false;
+    unsigned char* _buffer = nullptr; // the range, if the file is read
+    const unsigned char* _data = nullptr;
+    uint64_t _offset = 0; // of the range
+    uint64_t _size = 0;
+};
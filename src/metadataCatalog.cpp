@@ -0,0 +1,263 @@
+#include "metadataCatalog.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <unordered_set>
+#include <type_traits>
+#include <sys/stat.h>
+
+#include "logger.hpp"
+
+
+namespace {
+
+// FNV-1a, unlike `std::hash` it is the same across builds
+uint64_t HashPath(const std::string& path) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const unsigned char ch : path) {
+        hash ^= ch;
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static_assert(std::is_trivially_copyable_v<CatalogEntry>,
+    "catalog entries are written to the file as is");
+
+struct CatalogHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entrySize; // to detect layout changes of `CatalogEntry`
+    uint32_t count;
+};
+
+} // namespace
+
+
+MetadataCatalog::~MetadataCatalog() {
+    Close();
+}
+
+void MetadataCatalog::Open(const std::string& directory,
+    std::vector<std::string> filenames,
+    const std::string& fallbackDir) {
+    Close();
+
+    _directory = directory;
+    _catalogPath = GetCatalogPath(directory, fallbackDir);
+    Load();
+
+    _total = filenames.size();
+    _running = true;
+    _thread = std::thread(&MetadataCatalog::IndexLoop, this, std::move(filenames));
+}
+
+void MetadataCatalog::Close() {
+    if (_thread.joinable()) {
+        _stop = true;
+        _thread.join();
+    }
+
+    // keep what was indexed so far
+    Save();
+
+    std::lock_guard<std::mutex> lock{ _mutex };
+    _entries.clear();
+    _dirty = false;
+    _stop = false;
+    _finished = false;
+    _indexed = 0;
+    _total = 0;
+}
+
+bool MetadataCatalog::Get(const std::string& filename, ImageMetadata& metadata) const {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    const auto it = _entries.find(filename);
+    if (it == _entries.end())
+        return false;
+
+    metadata = it->second.metadata;
+    return true;
+}
+
+CatalogProgress MetadataCatalog::GetProgress() const {
+    return CatalogProgress{ _indexed.load(), _total.load() };
+}
+
+bool MetadataCatalog::PollFinished() {
+    return _finished.exchange(false);
+}
+
+void MetadataCatalog::IndexLoop(const std::vector<std::string> filenames) {
+    // drop the files that are gone
+    {
+        const std::unordered_set<std::string> listed{ filenames.begin(), filenames.end() };
+        std::lock_guard<std::mutex> lock{ _mutex };
+        for (auto it = _entries.begin(); it != _entries.end();) {
+            if (listed.count(it->first) == 0) {
+                it = _entries.erase(it);
+                _dirty = true;
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (const auto& filename : filenames) {
+        if (_stop)
+            return;
+
+        const std::string filepath = (std::filesystem::path{ _directory } / filename).string();
+        struct stat fileStat{};
+        // (files that cannot be read are counted too, so that the progress
+        // reaches the total)
+        if (stat(filepath.c_str(), &fileStat) != 0) {
+            ++_indexed;
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{ _mutex };
+            const auto it = _entries.find(filename);
+            if (it != _entries.end()
+                    && it->second.fileSize == static_cast<uint64_t>(fileStat.st_size)
+                    && it->second.metadata.modTime == static_cast<long>(fileStat.st_mtime)) {
+                ++_indexed;
+                continue;
+            }
+        }
+
+        // new or modified file, only the header is read
+        CatalogEntry entry{};
+        if (!ImageLoader::ReadMetadata(filepath, entry.metadata)) {
+            ++_indexed;
+            continue;
+        }
+
+        entry.fileSize = static_cast<uint64_t>(fileStat.st_size);
+        entry.metadata.modTime = static_cast<long>(fileStat.st_mtime);
+
+        std::lock_guard<std::mutex> lock{ _mutex };
+        _entries[filename] = entry;
+        _dirty = true;
+        ++_indexed;
+    }
+
+    Save();
+    // (set before `_running` is cleared, see `IsBusy`)
+    _finished = true;
+    _running = false;
+}
+
+bool MetadataCatalog::Load() {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    _entries.clear();
+    _dirty = false;
+
+    FILE* file = fopen(_catalogPath.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+
+    CatalogHeader header{};
+    bool valid = fread(&header, sizeof(header), 1, file) == 1
+        && std::memcmp(header.magic, _magic, sizeof(_magic)) == 0
+        && header.version == _version
+        && header.entrySize == sizeof(CatalogEntry);
+
+    // each entry: length of the filename, the filename and the `CatalogEntry`
+    // (a corrupted count cannot reserve more entries than the file can hold)
+    struct stat fileStat{};
+    valid = valid && fstat(fileno(file), &fileStat) == 0
+        && static_cast<uint64_t>(header.count) * (sizeof(uint16_t) + sizeof(CatalogEntry))
+            <= static_cast<uint64_t>(fileStat.st_size);
+    _entries.reserve(valid ? header.count : 0);
+    for (uint32_t i = 0; valid && i < header.count; ++i) {
+        uint16_t length = 0;
+        std::string filename;
+        CatalogEntry entry{};
+        valid = fread(&length, sizeof(length), 1, file) == 1;
+        if (valid) {
+            filename.resize(length);
+            valid = fread(filename.data(), sizeof(char), length, file) == length
+                && fread(&entry, sizeof(entry), 1, file) == 1;
+        }
+
+        if (valid) {
+            _entries.emplace(std::move(filename), entry);
+        }
+    }
+    fclose(file);
+
+    if (!valid) {
+        logger::warn("Discarding invalid metadata catalog: %s", _catalogPath.c_str());
+        _entries.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool MetadataCatalog::Save() {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    if (!_dirty || _catalogPath.empty())
+        return true;
+
+    std::error_code err;
+    std::filesystem::create_directories(std::filesystem::path{ _catalogPath }.parent_path(), err);
+
+    // write to a temporary file so that a crash never leaves a partial catalog
+    const std::string tmpPath = _catalogPath + ".tmp";
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if (file == nullptr) {
+        logger::warn("Failed to save the metadata catalog: %s", _catalogPath.c_str());
+        return false;
+    }
+
+    CatalogHeader header{};
+    std::memcpy(header.magic, _magic, sizeof(_magic));
+    header.version = _version;
+    header.entrySize = sizeof(CatalogEntry);
+    header.count = static_cast<uint32_t>(_entries.size());
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (const auto& [filename, entry] : _entries) {
+        const uint16_t length = static_cast<uint16_t>(filename.size());
+        written = written
+            && fwrite(&length, sizeof(length), 1, file) == 1
+            && fwrite(filename.data(), sizeof(char), length, file) == length
+            && fwrite(&entry, sizeof(entry), 1, file) == 1;
+    }
+    written = fclose(file) == 0 && written;
+
+    if (!written) {
+        logger::warn("Failed to save the metadata catalog: %s", _catalogPath.c_str());
+        std::filesystem::remove(tmpPath, err);
+        return false;
+    }
+
+    std::filesystem::rename(tmpPath, _catalogPath, err);
+    _dirty = false;
+    return !err;
+}
+
+std::string MetadataCatalog::GetCatalogPath(const std::string& directory,
+    const std::string& fallbackDir) {
+    std::string cacheDir;
+    if (const char* xdgCache = std::getenv("XDG_CACHE_HOME"); xdgCache && *xdgCache) {
+        cacheDir = std::string{ xdgCache } + "/photoViewer/";
+    } else if (const char* home = std::getenv("HOME"); home && *home) {
+        cacheDir = std::string{ home } + "/.cache/photoViewer/";
+    } else if (const char* localAppData = std::getenv("LOCALAPPDATA"); localAppData && *localAppData) {
+        cacheDir = std::string{ localAppData } + "/photoViewer/";
+    } else {
+        cacheDir = fallbackDir;
+    }
+
+    char filename[32];
+    snprintf(filename, sizeof(filename), "%016llx.catalog",
+        static_cast<unsigned long long>(HashPath(directory)));
+    return cacheDir + filename;
+}
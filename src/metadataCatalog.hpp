@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include "imageLoader.hpp"
+
+
+// metadata of a file in the catalog, written to disk as is
+struct CatalogEntry {
+    uint64_t fileSize = 0;
+    ImageMetadata metadata{};
+};
+
+struct CatalogProgress {
+    uint64_t indexed; // files that have up to date metadata
+    uint64_t total; // files in the directory
+};
+
+/**
+ * Persistent per-directory catalog of the image metadata (size, modification
+ * time, dimensions and EXIF data), so that the metadata of a directory that
+ * was opened before is known before any image gets decoded.
+ *
+ * The catalog is stored as a binary file in the cache directory
+ * (`$XDG_CACHE_HOME/photoViewer/` or `~/.cache/photoViewer/`) and is
+ * revalidated on a background thread when a directory is opened: one `stat`
+ * per file, and only the files that are new or whose size or modification
+ * time changed get their header read again.
+ */
+class MetadataCatalog {
+public:
+    MetadataCatalog() = default;
+    ~MetadataCatalog();
+
+    MetadataCatalog(const MetadataCatalog&) = delete;
+    MetadataCatalog(MetadataCatalog&&) = delete;
+    MetadataCatalog& operator=(const MetadataCatalog&) = delete;
+    MetadataCatalog& operator=(MetadataCatalog&&) = delete;
+
+    /**
+     * Loads the catalog of the directory and starts revalidating it.
+     * The previously opened catalog is closed first.
+     *
+     * @param `directory` - path of the directory (ending with a '/')
+     * @param `filenames` - image files in the directory, the entries of the
+     *                      other files are dropped
+     * @param `fallbackDir` - where to store the catalog if there is no
+     *                        cache directory (eg: the trash directory)
+     */
+    void Open(const std::string& directory,
+        std::vector<std::string> filenames,
+        const std::string& fallbackDir);
+
+    // stops the revalidation and saves the catalog
+    void Close();
+
+    /**
+     * @param `filename` - name of the file in the opened directory
+     * @param `metadata` - filled with the metadata of the file
+     * @returns false if the file is not in the catalog (yet)
+     */
+    bool Get(const std::string& filename, ImageMetadata& metadata) const;
+
+    [[nodiscard]] CatalogProgress GetProgress() const;
+
+    /**
+     * @returns true once after the revalidation finished
+     *          (eg: to sort the images again)
+     */
+    bool PollFinished();
+
+    // revalidating, or finished and not polled yet
+    [[nodiscard]] inline bool IsBusy() const { return _running || _finished; }
+
+private:
+    // revalidates the entries of `filenames`, runs on `_thread`
+    void IndexLoop(const std::vector<std::string> filenames);
+
+    bool Load();
+    bool Save();
+
+    /**
+     * @returns path of the catalog file in the cache directory,
+     *          named after a hash of the directory path
+     */
+    static std::string GetCatalogPath(const std::string& directory,
+        const std::string& fallbackDir);
+
+private:
+    constexpr static char _magic[4] = { 'P', 'V', 'M', 'C' };
+    constexpr static uint32_t _version = 1;
+
+    std::string _directory;
+    std::string _catalogPath;
+
+    mutable std::mutex _mutex;
+    std::unordered_map<std::string, CatalogEntry> _entries; // by filename
+    bool _dirty = false; // entries changed since they were loaded
+
+    std::thread _thread;
+    std::atomic<bool> _stop = false;
+    std::atomic<bool> _finished = false;
+    std::atomic<bool> _running = false; // `_thread` has not finished yet
+    std::atomic<uint64_t> _indexed = 0;
+    std::atomic<uint64_t> _total = 0;
+};
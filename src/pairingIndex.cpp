@@ -0,0 +1,141 @@
+#include "pairingIndex.hpp"
+
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+#include "directoryScanner.hpp"
+
+
+namespace {
+
+std::string ToLower(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(),
+        [](const unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    return str;
+}
+
+// start of the filename in the path
+size_t GetFilenameStart(const std::string& filepath) {
+    const size_t sep = filepath.find_last_of("\\/");
+    return sep == std::string::npos ? 0 : sep + 1;
+}
+
+} // namespace
+
+
+void PairingIndex::Clear(const std::string& rawExt) {
+    _rawExt = ToLower(rawExt);
+    _stems.clear();
+}
+
+void PairingIndex::Add(const std::string& filepath) {
+    PairedFileKind kind{};
+    if (!Classify(filepath.c_str() + GetFilenameStart(filepath), kind))
+        return;
+
+    std::vector<PairedFile>& files = _stems[GetStem(filepath, kind)];
+    const bool found = std::any_of(files.begin(), files.end(),
+        [&filepath](const PairedFile& file) { return file.filepath == filepath; });
+    if (!found) {
+        files.push_back(PairedFile{ .filepath = filepath, .kind = kind });
+    }
+}
+
+void PairingIndex::Remove(const std::string& filepath) {
+    PairedFileKind kind{};
+    if (!Classify(filepath.c_str() + GetFilenameStart(filepath), kind))
+        return;
+
+    auto it = _stems.find(GetStem(filepath, kind));
+    if (it == _stems.end())
+        return;
+
+    std::vector<PairedFile>& files = it->second;
+    files.erase(std::remove_if(files.begin(), files.end(),
+        [&filepath](const PairedFile& file) { return file.filepath == filepath; }),
+        files.end());
+    if (files.empty()) {
+        _stems.erase(it);
+    }
+}
+
+const std::vector<PairedFile>* PairingIndex::GetFiles(const std::string& filepath) const {
+    PairedFileKind kind{};
+    if (!Classify(filepath.c_str() + GetFilenameStart(filepath), kind))
+        return nullptr;
+
+    const auto it = _stems.find(GetStem(filepath, kind));
+    return it == _stems.end() ? nullptr : &it->second;
+}
+
+std::vector<std::string> PairingIndex::GetSiblings(const std::string& filepath) const {
+    std::vector<std::string> siblings;
+    const std::vector<PairedFile>* files = GetFiles(filepath);
+    if (files == nullptr)
+        return siblings;
+
+    // the other jpg/png images with the same name are separate images
+    for (const PairedFile& file : *files) {
+        if (file.kind != PairedFileKind::IMAGE && file.filepath != filepath) {
+            siblings.push_back(file.filepath);
+        }
+    }
+
+    return siblings;
+}
+
+std::vector<std::vector<std::string>> PairingIndex::GetOrphanRaws() const {
+    std::vector<std::vector<std::string>> orphans;
+    for (const auto& [stem, files] : _stems) {
+        const auto hasKind = [&files = files](const PairedFileKind kind) {
+            return std::any_of(files.begin(), files.end(),
+                [kind](const PairedFile& file) { return file.kind == kind; });
+        };
+        if (!hasKind(PairedFileKind::RAW) || hasKind(PairedFileKind::IMAGE))
+            continue;
+
+        // the raw files first
+        std::vector<std::string>& group = orphans.emplace_back();
+        for (const PairedFileKind kind : { PairedFileKind::RAW, PairedFileKind::SIDECAR }) {
+            for (const PairedFile& file : files) {
+                if (file.kind == kind) {
+                    group.push_back(file.filepath);
+                }
+            }
+        }
+    }
+
+    return orphans;
+}
+
+bool PairingIndex::Classify(const char* filename, PairedFileKind& kind) const {
+    const char* ext = std::strrchr(filename, '.');
+    if (ext == nullptr || ext == filename)
+        return false;
+
+    if (utils::HasRawExtension(filename) || (!_rawExt.empty() && ToLower(ext) == _rawExt)) {
+        kind = PairedFileKind::RAW;
+    } else if (utils::HasImageExtension(filename)) {
+        kind = PairedFileKind::IMAGE;
+    } else if (utils::HasSidecarExtension(filename)) {
+        kind = PairedFileKind::SIDECAR;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+std::string PairingIndex::GetStem(const std::string& filepath, const PairedFileKind kind) const {
+    std::string stem = filepath.substr(GetFilenameStart(filepath));
+    stem.erase(stem.find_last_of('.'));
+
+    // "IMG_0001.ARW.xmp" goes with "IMG_0001.ARW"
+    PairedFileKind innerKind{};
+    if (kind == PairedFileKind::SIDECAR && Classify(stem.c_str(), innerKind)
+            && innerKind != PairedFileKind::SIDECAR) {
+        stem.erase(stem.find_last_of('.'));
+    }
+
+    return stem;
+}
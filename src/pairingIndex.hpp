@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+
+enum class PairedFileKind : uint8_t {
+    IMAGE = 0, // jpg/png
+    RAW,
+    SIDECAR, // eg: ".xmp"
+};
+
+struct PairedFile {
+    std::string filepath;
+    PairedFileKind kind;
+};
+
+/**
+ * Index of the files that belong to the same photo: the jpg/png, the raw
+ * files (eg: ".ARW" and ".DNG") and the sidecar files (".xmp", both
+ * "IMG_0001.xmp" and "IMG_0001.ARW.xmp"), by the filename without the
+ * extension. The files can be in different directories (eg: the image and
+ * the raw image directories).
+ *
+ * Built once per directory while it is listed (see `DirectoryStream`), so
+ * that deleting an image does not need to look for its raw files.
+ */
+class PairingIndex {
+public:
+    PairingIndex() = default;
+
+    /**
+     * @param `rawExt` - raw extension of the config (eg: ".ARW"), files with
+     *                   it are raw files even if they are not TIFF based
+     */
+    void Clear(const std::string& rawExt);
+
+    // adds the file if it is an image, a raw or a sidecar file
+    void Add(const std::string& filepath);
+    void Remove(const std::string& filepath);
+
+    /**
+     * @returns the files with the same filename without the extension as
+     *          `filepath` (including itself), nullptr if there are none
+     */
+    [[nodiscard]] const std::vector<PairedFile>* GetFiles(const std::string& filepath) const;
+
+    // raw and sidecar files that go with `filepath` (not including itself)
+    [[nodiscard]] std::vector<std::string> GetSiblings(const std::string& filepath) const;
+
+    /**
+     * @returns the raw and sidecar files of the photos that have raw files
+     *          but no jpg/png, one group per photo (raw files first)
+     */
+    [[nodiscard]] std::vector<std::vector<std::string>> GetOrphanRaws() const;
+
+    [[nodiscard]] inline bool Empty() const { return _stems.empty(); }
+
+private:
+    /**
+     * @param `kind` - set to the kind of the file
+     * @returns false if the file is neither an image, a raw nor a sidecar
+     */
+    bool Classify(const char* filename, PairedFileKind& kind) const;
+
+    // filename without the extension(s), the key of `_stems`
+    std::string GetStem(const std::string& filepath, const PairedFileKind kind) const;
+
+private:
+    std::string _rawExt; // lower-case
+    std::unordered_map<std::string, std::vector<PairedFile>> _stems;
+};
@@ -0,0 +1,269 @@
+#include "pixelFormat.hpp"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define PIXEL_FORMAT_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define TARGET(isa)
+    #else
+        #define TARGET(isa) __attribute__((target(isa)))
+    #endif
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    #define PIXEL_FORMAT_NEON
+    #include <arm_neon.h>
+#endif
+
+
+namespace {
+
+// converts `count` pixels of one format
+using ExpandFunction = void (*)(const unsigned char* src, const size_t count, unsigned char* dst);
+
+struct Expanders {
+    ExpandFunction gray;
+    ExpandFunction grayAlpha;
+    ExpandFunction rgb;
+    const char* instructionSet;
+};
+
+void ExpandGrayScalar(const unsigned char* src, const size_t count, unsigned char* dst) {
+    for (size_t i = 0; i < count; ++i, dst += 4) {
+        dst[0] = dst[1] = dst[2] = src[i];
+        dst[3] = 255;
+    }
+}
+
+void ExpandGrayAlphaScalar(const unsigned char* src, const size_t count, unsigned char* dst) {
+    for (size_t i = 0; i < count; ++i, src += 2, dst += 4) {
+        dst[0] = dst[1] = dst[2] = src[0];
+        dst[3] = src[1];
+    }
+}
+
+void ExpandRGBScalar(const unsigned char* src, const size_t count, unsigned char* dst) {
+    for (size_t i = 0; i < count; ++i, src += 3, dst += 4) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = 255;
+    }
+}
+
+#if defined(PIXEL_FORMAT_X86)
+
+TARGET("sse2")
+void ExpandGraySSE2(const unsigned char* src, const size_t count, unsigned char* dst) {
+    const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i gray = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // (g, g) and (g, a) pairs, interleaved into (g, g, g, a)
+        const __m128i grayLow = _mm_unpacklo_epi8(gray, gray);
+        const __m128i grayHigh = _mm_unpackhi_epi8(gray, gray);
+        const __m128i alphaLow = _mm_unpacklo_epi8(gray, alpha);
+        const __m128i alphaHigh = _mm_unpackhi_epi8(gray, alpha);
+        __m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+        _mm_storeu_si128(out, _mm_unpacklo_epi16(grayLow, alphaLow));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(grayLow, alphaLow));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(grayHigh, alphaHigh));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(grayHigh, alphaHigh));
+    }
+
+    ExpandGrayScalar(src + i, count - i, dst + i * 4);
+}
+
+TARGET("sse2")
+void ExpandGrayAlphaSSE2(const unsigned char* src, const size_t count, unsigned char* dst) {
+    const __m128i grayMask = _mm_set1_epi16(0x00FF);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // (g, a) pairs, the gray is doubled into (g, g) pairs
+        const __m128i grayAlpha = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        const __m128i gray = _mm_and_si128(grayAlpha, grayMask);
+        const __m128i grayGray = _mm_or_si128(gray, _mm_slli_epi16(gray, 8));
+        __m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+        _mm_storeu_si128(out, _mm_unpacklo_epi16(grayGray, grayAlpha));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(grayGray, grayAlpha));
+    }
+
+    ExpandGrayAlphaScalar(src + i * 2, count - i, dst + i * 4);
+}
+
+TARGET("ssse3")
+void ExpandRGBSSSE3(const unsigned char* src, const size_t count, unsigned char* dst) {
+    // 4 pixels from the first 12 bytes, 0x80 clears the alpha byte
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11, -128);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i* in = reinterpret_cast<const __m128i*>(src + i * 3);
+        const __m128i a = _mm_loadu_si128(in);
+        const __m128i b = _mm_loadu_si128(in + 1);
+        const __m128i c = _mm_loadu_si128(in + 2);
+        __m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+        _mm_storeu_si128(out, _mm_or_si128(_mm_shuffle_epi8(a, shuffle), alpha));
+        _mm_storeu_si128(out + 1, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), shuffle), alpha));
+        _mm_storeu_si128(out + 2, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), shuffle), alpha));
+        _mm_storeu_si128(out + 3, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), shuffle), alpha));
+    }
+
+    ExpandRGBScalar(src + i * 3, count - i, dst + i * 4);
+}
+
+TARGET("avx2")
+void ExpandGrayAVX2(const unsigned char* src, const size_t count, unsigned char* dst) {
+    const __m256i spread = _mm256_set1_epi32(0x010101);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i gray = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // one pixel per 32-bit lane, g * 0x010101 = (g, g, g, 0)
+        const __m256i low = _mm256_cvtepu8_epi32(gray);
+        const __m256i high = _mm256_cvtepu8_epi32(_mm_srli_si128(gray, 8));
+        __m256i* out = reinterpret_cast<__m256i*>(dst + i * 4);
+        _mm256_storeu_si256(out, _mm256_or_si256(_mm256_mullo_epi32(low, spread), alpha));
+        _mm256_storeu_si256(out + 1, _mm256_or_si256(_mm256_mullo_epi32(high, spread), alpha));
+    }
+
+    ExpandGrayScalar(src + i, count - i, dst + i * 4);
+}
+
+TARGET("avx2")
+void ExpandGrayAlphaAVX2(const unsigned char* src, const size_t count, unsigned char* dst) {
+    const __m256i grayMask = _mm256_set1_epi32(0xFF);
+    const __m256i spread = _mm256_set1_epi32(0x010101);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // one (g, a) pair per 32-bit lane
+        const __m256i grayAlpha = _mm256_cvtepu16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2)));
+        const __m256i gray = _mm256_mullo_epi32(_mm256_and_si256(grayAlpha, grayMask), spread);
+        const __m256i alpha = _mm256_slli_epi32(_mm256_srli_epi32(grayAlpha, 8), 24);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_or_si256(gray, alpha));
+    }
+
+    ExpandGrayAlphaScalar(src + i * 2, count - i, dst + i * 4);
+}
+
+TARGET("avx2")
+void ExpandRGBAVX2(const unsigned char* src, const size_t count, unsigned char* dst) {
+    // the 24 bytes of 8 pixels are split into bytes 0-15 and 12-27, one
+    // half per 128-bit lane (the shuffle does not cross lanes)
+    const __m256i split = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+    const __m256i shuffle = _mm256_setr_epi8(
+        0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11, -128,
+        0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11, -128);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+    size_t i = 0;
+    // 32 bytes are loaded for 24, the last pixels are left to the scalar loop
+    for (; i + 11 <= count; i += 8) {
+        const __m256i rgb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 3));
+        const __m256i halves = _mm256_permutevar8x32_epi32(rgb, split);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4),
+            _mm256_or_si256(_mm256_shuffle_epi8(halves, shuffle), alpha));
+    }
+
+    ExpandRGBScalar(src + i * 3, count - i, dst + i * 4);
+}
+
+bool HasSSSE3AndAVX2(bool& avx2) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4]{};
+    __cpuid(info, 1);
+    const bool ssse3 = (info[2] & (1 << 9)) != 0;
+    // the OS saves the AVX registers
+    const bool osAVX = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0
+        && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    avx2 = osAVX && (info[1] & (1 << 5)) != 0;
+    return ssse3;
+#else
+    __builtin_cpu_init();
+    avx2 = __builtin_cpu_supports("avx2");
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+#elif defined(PIXEL_FORMAT_NEON)
+
+void ExpandGrayNEON(const unsigned char* src, const size_t count, unsigned char* dst) {
+    const uint8x16_t alpha = vdupq_n_u8(255);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16_t gray = vld1q_u8(src + i);
+        vst4q_u8(dst + i * 4, uint8x16x4_t{ { gray, gray, gray, alpha } });
+    }
+
+    ExpandGrayScalar(src + i, count - i, dst + i * 4);
+}
+
+void ExpandGrayAlphaNEON(const unsigned char* src, const size_t count, unsigned char* dst) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16x2_t grayAlpha = vld2q_u8(src + i * 2);
+        vst4q_u8(dst + i * 4,
+            uint8x16x4_t{ { grayAlpha.val[0], grayAlpha.val[0], grayAlpha.val[0], grayAlpha.val[1] } });
+    }
+
+    ExpandGrayAlphaScalar(src + i * 2, count - i, dst + i * 4);
+}
+
+void ExpandRGBNEON(const unsigned char* src, const size_t count, unsigned char* dst) {
+    const uint8x16_t alpha = vdupq_n_u8(255);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+        vst4q_u8(dst + i * 4, uint8x16x4_t{ { rgb.val[0], rgb.val[1], rgb.val[2], alpha } });
+    }
+
+    ExpandRGBScalar(src + i * 3, count - i, dst + i * 4);
+}
+
+#endif
+
+Expanders PickExpanders() {
+#if defined(PIXEL_FORMAT_X86)
+    bool avx2 = false;
+    const bool ssse3 = HasSSSE3AndAVX2(avx2);
+    if (avx2)
+        return Expanders{ ExpandGrayAVX2, ExpandGrayAlphaAVX2, ExpandRGBAVX2, "avx2" };
+    if (ssse3)
+        return Expanders{ ExpandGraySSE2, ExpandGrayAlphaSSE2, ExpandRGBSSSE3, "ssse3" };
+    // SSE2 is part of x86-64
+    return Expanders{ ExpandGraySSE2, ExpandGrayAlphaSSE2, ExpandRGBScalar, "sse2" };
+#elif defined(PIXEL_FORMAT_NEON)
+    return Expanders{ ExpandGrayNEON, ExpandGrayAlphaNEON, ExpandRGBNEON, "neon" };
+#else
+    return Expanders{ ExpandGrayScalar, ExpandGrayAlphaScalar, ExpandRGBScalar, "scalar" };
+#endif
+}
+
+const Expanders& GetExpanders() {
+    static const Expanders expanders = PickExpanders();
+    return expanders;
+}
+
+} // namespace
+
+
+namespace pixelFormat {
+
+void ExpandToRGBA(const unsigned char* src, const int channels, const size_t count, unsigned char* dst) {
+    const Expanders& expanders = GetExpanders();
+    if (channels == 1) {
+        expanders.gray(src, count, dst);
+    } else if (channels == 2) {
+        expanders.grayAlpha(src, count, dst);
+    } else if (channels == 3) {
+        expanders.rgb(src, count, dst);
+    }
+}
+
+const char* GetInstructionSet() {
+    return GetExpanders().instructionSet;
+}
+
+}
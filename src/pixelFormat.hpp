@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+
+/**
+ * Expands the gray, gray + alpha and RGB pixels decoded by stb_image to
+ * RGBA8 on the decode workers, so that every texture is uploaded in one
+ * format, with a stride of 4 bytes per pixel (the driver does not pad RGB
+ * or swizzle gray on the render thread).
+ *
+ * The conversion is picked once from the features of the CPU: AVX2, then
+ * SSSE3 (RGB) and SSE2 (gray) on x86, NEON on ARM, and a scalar loop
+ * otherwise. The pixels are little-endian RGBA, raylib has no BGRA format.
+ */
+namespace pixelFormat {
+
+/**
+ * @param `channels` - bytes per pixel of `src` (1: gray, 2: gray + alpha,
+ *                     3: RGB)
+ * @param `count` - number of pixels
+ * @param `dst` - `count * 4` bytes, must not overlap `src`
+ */
+void ExpandToRGBA(const unsigned char* src, const int channels, const size_t count, unsigned char* dst);
+
+// instruction set used by `ExpandToRGBA` (eg: "avx2")
+const char* GetInstructionSet();
+
+}
@@ -0,0 +1,43 @@
+#include "stbImage.hpp"
+
+#include "bufferPool.hpp"
+
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_PNG
+#define STBI_MALLOC(size) BufferPool::Get().Allocate(size)
+#define STBI_REALLOC(ptr, newSize) BufferPool::Get().Reallocate(ptr, 0, newSize)
+#define STBI_REALLOC_SIZED(ptr, oldSize, newSize) BufferPool::Get().Reallocate(ptr, oldSize, newSize)
+#define STBI_FREE(ptr) BufferPool::Get().Free(ptr)
+// only the functions below are used
+#if defined(__GNUC__)
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wunused-function"
+    #pragma GCC diagnostic ignored "-Wconversion"
+#endif
+#include "raylib/src/external/stb_image.h"
+#if defined(__GNUC__)
+    #pragma GCC diagnostic pop
+#endif
+
+
+namespace stbImage {
+
+unsigned char* LoadFromMemory(const unsigned char* buffer,
+    const int size,
+    int& width,
+    int& height,
+    int& comp) {
+    return stbi_load_from_memory(buffer, size, &width, &height, &comp, 0);
+}
+
+bool InfoFromMemory(const unsigned char* buffer,
+    const int size,
+    int& width,
+    int& height,
+    int& comp) {
+    return stbi_info_from_memory(buffer, size, &width, &height, &comp) != 0;
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+
+/**
+ * stb_image compiled in its own translation unit (separate from the copy in
+ * raylib), with its allocations going to `BufferPool`. Only JPEG and PNG are
+ * decoded.
+ */
+namespace stbImage {
+
+/**
+ * @param `comp` - set to the number of components (1-4)
+ * @returns the pixels, allocated from `BufferPool` (free them with
+ *          `BufferPool::Free`), nullptr if the image could not be decoded
+ */
+unsigned char* LoadFromMemory(const unsigned char* buffer,
+    const int size,
+    int& width,
+    int& height,
+    int& comp);
+
+// reads the dimensions from the header, returns false if it is not found
+bool InfoFromMemory(const unsigned char* buffer,
+    const int size,
+    int& width,
+    int& height,
+    int& comp);
+
+}
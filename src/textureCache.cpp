@@ -0,0 +1,253 @@
+#include "textureCache.hpp"
+
+#include <string>
+#include <algorithm>
+#include "bufferPool.hpp"
+#include "tiledTexture.hpp"
+
+
+namespace {
+
+// bytes used by all the mipmap levels
+uint64_t GetDataSize(int width, int height, const int mipmaps, const int format) {
+    uint64_t size = 0;
+    for (int i = 0; i < mipmaps; ++i) {
+        size += static_cast<uint64_t>(GetPixelDataSize(width, height, format));
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    return size;
+}
+
+void ApplyFiltering(const Texture2D& texture, const TextureFiltering filtering) {
+    // the edges would be blended with the opposite side
+    SetTextureWrap(texture, TEXTURE_WRAP_CLAMP);
+
+    if (filtering == TextureFiltering::POINT) {
+        SetTextureFilter(texture, TEXTURE_FILTER_POINT);
+    } else if (filtering == TextureFiltering::BILINEAR || texture.mipmaps <= 1) {
+        SetTextureFilter(texture, TEXTURE_FILTER_BILINEAR);
+    } else {
+        SetTextureFilter(texture, TEXTURE_FILTER_TRILINEAR);
+    }
+}
+
+} // namespace
+
+
+TextureCache::TextureCache(const uint64_t textureBudget,
+    const uint64_t imageBudget,
+    const TextureFiltering filtering)
+    : _textureBudget{ textureBudget },
+      _imageBudget{ imageBudget },
+      _filtering{ filtering },
+      _maxTextureSize{ std::min(TiledTexture::GetMaxTextureSize(), _maxSingleTextureSize) } {
+}
+
+TextureCache::~TextureCache() {
+    Clear();
+}
+
+const CachedTexture* TextureCache::Get(const std::string& filepath,
+    const long modTime,
+    const bool countAccess) {
+    const auto it = _lookup.find(MakeKey(filepath, modTime));
+    if (it == _lookup.end()) {
+        if (countAccess)
+            ++_stats.misses;
+
+        return nullptr;
+    }
+
+    if (countAccess)
+        ++_stats.hits;
+
+    // move to the front of the list (most recently used)
+    _entries.splice(_entries.begin(), _entries, it->second);
+    CachedTexture& entry = *it->second;
+
+    if (entry.texture.id == 0 && entry.image.data != nullptr) {
+        LoadEntryTexture(entry);
+        Evict();
+    }
+
+    return &entry;
+}
+
+const CachedTexture& TextureCache::Insert(LoadedImage& loaded) {
+    const std::string key = MakeKey(loaded.filepath, loaded.modTime);
+    const auto it = _lookup.find(key);
+    if (it != _lookup.end() && loaded.downscaled && !it->second->downscaled) {
+        BufferPool::Get().FreeImage(loaded.image);
+        return *Get(loaded.filepath, loaded.modTime, false);
+    }
+    if (it != _lookup.end()) {
+        // already cached, replace it (the one on screen is drawn until the
+        // new texture is uploaded)
+        if (key == _pinnedKey) {
+            _retired.push_back(std::move(*it->second));
+        } else {
+            UnloadEntryTexture(*it->second);
+            UnloadEntryImage(*it->second);
+        }
+        _entries.erase(it->second);
+        _lookup.erase(it);
+        --_stats.entries;
+    }
+
+    CachedTexture entry{};
+    entry.filepath = loaded.filepath;
+    entry.modTime = loaded.modTime;
+    entry.exif = loaded.exif;
+    entry.imageWidth = loaded.imageWidth;
+    entry.imageHeight = loaded.imageHeight;
+    entry.downscaled = loaded.downscaled;
+    entry.image = loaded.image;
+    loaded.image = Image{};
+
+    _stats.imageBytes += GetDataSize(entry.image.width, entry.image.height,
+        entry.image.mipmaps, entry.image.format);
+    LoadEntryTexture(entry);
+
+    _entries.push_front(std::move(entry));
+    _lookup[key] = _entries.begin();
+    ++_stats.entries;
+
+    Evict();
+    return _entries.front();
+}
+
+void TextureCache::Pin(const CachedTexture& cached) {
+    _pinnedKey = MakeKey(cached.filepath, cached.modTime);
+
+    for (auto& entry : _retired) {
+        UnloadEntryTexture(entry);
+        UnloadEntryImage(entry);
+    }
+    _retired.clear();
+}
+
+void TextureCache::Update() {
+    _uploader.Update(_uploaded);
+    for (const unsigned int id : _uploaded) {
+        const auto it = std::find_if(_entries.begin(), _entries.end(),
+            [id](const CachedTexture& entry) { return entry.texture.id == id; });
+        if (it != _entries.end()) {
+            it->uploading = false;
+        }
+    }
+
+    // they were skipped while being uploaded
+    if (!_uploaded.empty()) {
+        Evict();
+    }
+}
+
+void TextureCache::SetBudget(const uint64_t textureBudget, const uint64_t imageBudget) {
+    _textureBudget = textureBudget;
+    _imageBudget = imageBudget;
+    Evict();
+}
+
+void TextureCache::SetFiltering(const TextureFiltering filtering) {
+    _filtering = filtering;
+    for (const auto& entry : _entries) {
+        if (entry.texture.id != 0) {
+            ApplyFiltering(entry.texture, _filtering);
+        }
+    }
+}
+
+void TextureCache::Clear() {
+    for (auto& entry : _entries) {
+        UnloadEntryTexture(entry);
+        UnloadEntryImage(entry);
+    }
+    for (auto& entry : _retired) {
+        UnloadEntryTexture(entry);
+        UnloadEntryImage(entry);
+    }
+
+    _entries.clear();
+    _retired.clear();
+    _uploader.Clear();
+    _lookup.clear();
+    _pinnedKey.clear();
+    _stats.entries = 0;
+}
+
+std::string TextureCache::MakeKey(const std::string& filepath, const long modTime) {
+    return filepath + '|' + std::to_string(modTime);
+}
+
+void TextureCache::LoadEntryTexture(CachedTexture& entry) {
+    if (entry.image.width > _maxTextureSize || entry.image.height > _maxTextureSize) {
+        entry.tiled = true;
+        return;
+    }
+
+    entry.texture = _uploader.Upload(entry.image);
+    if (entry.texture.id == 0)
+        return;
+
+    entry.uploading = _uploader.IsUploading(entry.texture.id);
+    ApplyFiltering(entry.texture, _filtering);
+    _stats.textureBytes += GetDataSize(entry.texture.width, entry.texture.height,
+        entry.texture.mipmaps, entry.texture.format);
+}
+
+void TextureCache::UnloadEntryTexture(CachedTexture& entry) {
+    if (entry.texture.id == 0)
+        return;
+
+    if (entry.uploading) {
+        _uploader.Cancel(entry.texture.id);
+        entry.uploading = false;
+    }
+
+    _stats.textureBytes -= GetDataSize(entry.texture.width, entry.texture.height,
+        entry.texture.mipmaps, entry.texture.format);
+    UnloadTexture(entry.texture);
+    entry.texture = Texture2D{};
+}
+
+void TextureCache::UnloadEntryImage(CachedTexture& entry) {
+    if (entry.image.data == nullptr)
+        return;
+
+    _stats.imageBytes -= GetDataSize(entry.image.width, entry.image.height,
+        entry.image.mipmaps, entry.image.format);
+    BufferPool::Get().FreeImage(entry.image);
+}
+
+void TextureCache::Evict() {
+    if (_entries.size() < 2)
+        return;
+
+    // walk from the least recently used entry,
+    // the most recently used one is always kept
+    const auto mostRecent = _entries.begin();
+    auto it = _entries.end();
+    while (--it != mostRecent
+            && (_stats.textureBytes > _textureBudget || _stats.imageBytes > _imageBudget)) {
+        // the pixels of the textures being uploaded are still read
+        const std::string key = MakeKey(it->filepath, it->modTime);
+        if (key == _pinnedKey || it->uploading)
+            continue;
+
+        if (_stats.textureBytes > _textureBudget) {
+            UnloadEntryTexture(*it);
+        }
+        if (_stats.imageBytes > _imageBudget) {
+            UnloadEntryImage(*it);
+        }
+
+        // nothing left to keep
+        if (it->texture.id == 0 && it->image.data == nullptr) {
+            _lookup.erase(key);
+            it = _entries.erase(it);
+            --_stats.entries;
+        }
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <optional>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include "raylib.h"
+#include "tinyexif/exif.h"
+#include "imageLoader.hpp"
+#include "textureUploader.hpp"
+#include "types.hpp"
+
+
+// decoded image, kept on the GPU (`texture`) and/or in RAM (`image`)
+struct CachedTexture {
+    std::string filepath;
+    long modTime = 0; // modification time of the file when it was decoded
+    Texture2D texture{};
+    Image image{};
+    std::optional<tinyexif::EXIFRecord> exif;
+    int imageWidth = 0; // size of the full image
+    int imageHeight = 0;
+    bool downscaled = false; // decoded at the display size, see `ImageLoader::Request`
+    // too large for a single texture, `image` is drawn with `TiledTexture`
+    // (there is no `texture`)
+    bool tiled = false;
+    // `texture` is being uploaded over several frames, it cannot be drawn yet
+    bool uploading = false;
+};
+
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t textureBytes = 0; // VRAM used by the cached textures
+    uint64_t imageBytes = 0; // RAM used by the cached images
+    uint64_t entries = 0;
+};
+
+/**
+ * Least-recently-used cache of decoded images, keyed by file path and
+ * modification time. Each entry keeps the uploaded texture and the decoded
+ * pixels; each is evicted separately once over its budget, so revisiting an
+ * image whose texture was evicted only costs an upload instead of a decode.
+ * The textures are uploaded in the background by `TextureUploader`.
+ * Must be used from the thread that owns the GL context.
+ */
+class TextureCache {
+public:
+    /**
+     * @param `textureBudget` - max bytes of textures (VRAM)
+     * @param `imageBudget` - max bytes of decoded images (RAM)
+     * @param `filtering` - of the uploaded textures
+     */
+    TextureCache(const uint64_t textureBudget,
+        const uint64_t imageBudget,
+        const TextureFiltering filtering);
+    ~TextureCache();
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache(TextureCache&&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+    TextureCache& operator=(TextureCache&&) = delete;
+
+    /**
+     * Looks up an image and marks it as most recently used. If only the
+     * decoded pixels are cached, their upload to the GPU is started.
+     *
+     * @param `filepath` - path of the image
+     * @param `modTime` - current modification time of the file
+     * @param `countAccess` - count the lookup as a hit/miss
+     *                        (false for prefetching)
+     * @returns the cached texture or nullptr if the image is not cached
+     */
+    const CachedTexture* Get(const std::string& filepath, const long modTime,
+        const bool countAccess = true);
+
+    /**
+     * Starts uploading the decoded image to the GPU and keeps the pixels in
+     * RAM. Takes the ownership of `loaded.image`. A downscaled image does
+     * not replace the full resolution one if it is cached. If the entry on
+     * screen is replaced, its texture is kept until the next `Pin`.
+     *
+     * @param `loaded` - decoded image
+     * @returns the inserted entry
+     */
+    const CachedTexture& Insert(LoadedImage& loaded);
+
+    /**
+     * Marks the texture that is on screen, it is never evicted. Unloads the
+     * replaced entry that was on screen until now.
+     * @param `cached` - entry returned by `Get` or `Insert`
+     */
+    void Pin(const CachedTexture& cached);
+
+    /**
+     * Uploads the next bands of the textures.
+     * This function should be called once every frame
+     */
+    void Update();
+
+    void SetBudget(const uint64_t textureBudget, const uint64_t imageBudget);
+
+    // also changes the filtering of the cached textures
+    void SetFiltering(const TextureFiltering filtering);
+
+    // unloads all the textures and images (the stats are kept)
+    void Clear();
+
+    [[nodiscard]] inline CacheStats GetStats() const { return _stats; }
+    [[nodiscard]] inline bool IsUploading() const { return !_uploader.Empty(); }
+
+private:
+    // images larger than this are tiled even if the GPU supports them, so
+    // that only the part on screen takes VRAM
+    constexpr static int _maxSingleTextureSize = 8192;
+
+    using EntryList = std::list<CachedTexture>;
+
+    static std::string MakeKey(const std::string& filepath, const long modTime);
+
+    // starts uploading the pixels of the entry (with all the mipmap levels)
+    void LoadEntryTexture(CachedTexture& entry);
+    void UnloadEntryTexture(CachedTexture& entry);
+    void UnloadEntryImage(CachedTexture& entry);
+
+    // evicts the least recently used textures and images until within budget
+    void Evict();
+
+private:
+    uint64_t _textureBudget;
+    uint64_t _imageBudget;
+    TextureFiltering _filtering;
+    int _maxTextureSize; // larger images are tiled
+    EntryList _entries; // most recently used first
+    std::unordered_map<std::string, EntryList::iterator> _lookup;
+    std::string _pinnedKey;
+    // replaced while on screen, unloaded once the next texture is shown
+    std::vector<CachedTexture> _retired;
+    TextureUploader _uploader;
+    std::vector<unsigned int> _uploaded; // by the last `_uploader.Update`
+    CacheStats _stats{};
+};
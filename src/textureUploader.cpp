@@ -0,0 +1,274 @@
+#include "textureUploader.hpp"
+
+// before anything that includes the OpenGL headers
+#include "raylib/src/external/glad.h"
+#include "rlgl.h"
+
+#include <algorithm>
+#include <cstring>
+#include "logger.hpp"
+
+
+namespace {
+
+// a failed wait is treated as signaled, so that the upload is not stuck
+bool IsSignaled(void* fence) {
+    const GLenum status = glClientWaitSync(static_cast<GLsync>(fence), 0, 0);
+    return status != GL_TIMEOUT_EXPIRED;
+}
+
+void DeleteFence(void*& fence) {
+    if (fence == nullptr)
+        return;
+
+    glDeleteSync(static_cast<GLsync>(fence));
+    fence = nullptr;
+}
+
+// same sizes as `rlLoadTexture` (halved and rounded down, at least 1)
+int GetLevelSize(int size, const int level) {
+    for (int i = 0; i < level; ++i) {
+        size = size > 1 ? size / 2 : 1;
+    }
+
+    return size;
+}
+
+} // namespace
+
+
+TextureUploader::~TextureUploader() {
+    Clear();
+}
+
+Texture2D TextureUploader::Upload(const Image& image) {
+    // a row has to fit in a buffer
+    if (image.data == nullptr || image.format >= PIXELFORMAT_COMPRESSED_DXT1_RGB
+            || static_cast<size_t>(GetPixelDataSize(image.width, 1, image.format)) > _bufferSize
+            || !Init())
+        return LoadTextureFromImage(image);
+
+    // allocates all the levels, the pixels are uploaded in `Update`
+    const Texture2D texture{
+        .id = rlLoadTexture(nullptr, image.width, image.height, image.format, image.mipmaps),
+        .width = image.width,
+        .height = image.height,
+        .mipmaps = image.mipmaps,
+        .format = image.format,
+    };
+    if (texture.id == 0)
+        return texture;
+
+    _uploads.push_back(PendingUpload{
+        .textureId = texture.id,
+        .image = image,
+        .level = 0,
+        .row = 0,
+        .levelOffset = 0,
+        .fence = nullptr,
+    });
+    return texture;
+}
+
+void TextureUploader::Cancel(const unsigned int textureId) {
+    const auto it = std::find_if(_uploads.begin(), _uploads.end(),
+        [textureId](const PendingUpload& upload) { return upload.textureId == textureId; });
+    if (it == _uploads.end())
+        return;
+
+    // the bands in flight read from the buffers, not from the pixels
+    DeleteFence(it->fence);
+    _uploads.erase(it);
+}
+
+void TextureUploader::Update(std::vector<unsigned int>& completed) {
+    completed.clear();
+    if (_uploads.empty())
+        return;
+
+    // at most one fill of each buffer per frame, in turns
+    for (size_t i = 0; i < _bufferCount; ++i) {
+        const auto upload = std::find_if(_uploads.begin(), _uploads.end(),
+            [](const PendingUpload& pending) { return pending.fence == nullptr; });
+        if (upload == _uploads.end())
+            break;
+
+        PixelBuffer& buffer = _buffers[_nextBuffer];
+        if (buffer.fence != nullptr) {
+            if (!IsSignaled(buffer.fence))
+                break;
+
+            DeleteFence(buffer.fence);
+        }
+
+        // tried again in the next frame
+        if (!FillBuffer(*upload, buffer))
+            break;
+
+        _nextBuffer = (_nextBuffer + 1) % _bufferCount;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    for (auto it = _uploads.begin(); it != _uploads.end();) {
+        if (it->fence != nullptr && IsSignaled(it->fence)) {
+            DeleteFence(it->fence);
+            completed.push_back(it->textureId);
+            it = _uploads.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool TextureUploader::IsUploading(const unsigned int textureId) const {
+    return std::any_of(_uploads.begin(), _uploads.end(),
+        [textureId](const PendingUpload& upload) { return upload.textureId == textureId; });
+}
+
+void TextureUploader::Clear() {
+    for (auto& upload : _uploads) {
+        DeleteFence(upload.fence);
+    }
+    _uploads.clear();
+
+    if (!_initialized)
+        return;
+
+    for (auto& buffer : _buffers) {
+        DeleteFence(buffer.fence);
+        if (buffer.id == 0)
+            continue;
+
+        if (buffer.mapped != nullptr) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        glDeleteBuffers(1, &buffer.id);
+        buffer = PixelBuffer{};
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // created again by the next upload
+    _initialized = false;
+    _nextBuffer = 0;
+}
+
+bool TextureUploader::Init() {
+    if (_initialized)
+        return _supported;
+
+    _initialized = true;
+    // pixel buffers are core since OpenGL 2.1, fences since 3.2
+    _supported = GLAD_GL_VERSION_3_2 != 0;
+    if (!_supported) {
+        logger::warn("Fences are not supported, the textures are uploaded at once");
+        return false;
+    }
+
+    _persistent = GLAD_GL_ARB_buffer_storage != 0;
+    const GLbitfield persistentFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    for (auto& buffer : _buffers) {
+        glGenBuffers(1, &buffer.id);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+        if (_persistent) {
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, _bufferSize, nullptr, persistentFlags);
+            buffer.mapped = static_cast<unsigned char*>(
+                glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, _bufferSize, persistentFlags));
+            if (buffer.mapped == nullptr) {
+                // the storage cannot be allocated again, the buffer is replaced
+                glDeleteBuffers(1, &buffer.id);
+                glGenBuffers(1, &buffer.id);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, _bufferSize, nullptr, GL_STREAM_DRAW);
+            }
+        } else {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, _bufferSize, nullptr, GL_STREAM_DRAW);
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    _persistent = std::all_of(std::begin(_buffers), std::end(_buffers),
+        [](const PixelBuffer& buffer) { return buffer.mapped != nullptr; });
+    logger::info("Uploading textures through %zu %s pixel buffers of %zuMB",
+        _bufferCount,
+        _persistent ? "persistently mapped" : "mapped",
+        _bufferSize / (1024 * 1024));
+    return true;
+}
+
+bool TextureUploader::FillBuffer(PendingUpload& upload, PixelBuffer& buffer) {
+    const Image& image = upload.image;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+
+    unsigned char* mapped = buffer.mapped;
+    if (mapped == nullptr) {
+        // the last band in the buffer has been read, its fence has signaled
+        mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, _bufferSize,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        if (mapped == nullptr)
+            return false;
+    }
+
+    // the rows left in the level, and the next levels (the smallest ones
+    // fit in a single fill)
+    const PendingUpload start = upload;
+    struct Band {
+        int level;
+        int row;
+        int width;
+        int rows;
+        size_t offset; // in the buffer
+    };
+    std::vector<Band> bands;
+    size_t used = 0;
+    while (upload.level < image.mipmaps) {
+        const int width = GetLevelSize(image.width, upload.level);
+        const int height = GetLevelSize(image.height, upload.level);
+        const size_t rowSize = static_cast<size_t>(GetPixelDataSize(width, 1, image.format));
+        const int rows = std::min(height - upload.row, static_cast<int>((_bufferSize - used) / rowSize));
+        if (rows <= 0)
+            break;
+
+        const size_t bandSize = rowSize * static_cast<size_t>(rows);
+        std::memcpy(mapped + used,
+            static_cast<const unsigned char*>(image.data) + upload.levelOffset
+                + rowSize * static_cast<size_t>(upload.row),
+            bandSize);
+        bands.push_back(Band{ upload.level, upload.row, width, rows, used });
+        used += bandSize;
+
+        upload.row += rows;
+        if (upload.row >= height) {
+            upload.levelOffset += static_cast<size_t>(GetPixelDataSize(width, height, image.format));
+            upload.row = 0;
+            ++upload.level;
+        }
+    }
+
+    // the contents are lost if the buffer got corrupted (eg: a display mode
+    // change), the bands are copied again in the next frame
+    if (buffer.mapped == nullptr && glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) != GL_TRUE) {
+        upload = start;
+        return false;
+    }
+
+    unsigned int glInternalFormat = 0;
+    unsigned int glFormat = 0;
+    unsigned int glType = 0;
+    rlGetGlTextureFormats(image.format, &glInternalFormat, &glFormat, &glType);
+    glBindTexture(GL_TEXTURE_2D, upload.textureId);
+    for (const Band& band : bands) {
+        // reads from the bound pixel buffer, at the offset
+        glTexSubImage2D(GL_TEXTURE_2D, band.level, 0, band.row, band.width, band.rows,
+            glFormat, glType, reinterpret_cast<const void*>(band.offset));
+    }
+
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (upload.level >= image.mipmaps) {
+        upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include "raylib.h"
+
+
+/**
+ * Uploads textures over several frames through a pair of pixel buffer
+ * objects, instead of one `glTexImage2D` of the whole image (up to 100MB)
+ * that stalls the frame it is called in.
+ *
+ * The storage of the texture (with all its mipmap levels) is allocated
+ * right away with `rlLoadTexture`, then each frame the next row bands of
+ * the levels are copied to a pixel buffer and `glTexSubImage2D` reads them
+ * from there without blocking. A buffer is written again only once the
+ * fence of its last band has signaled, and a texture can be drawn once the
+ * fence of its last band has.
+ *
+ * The buffers are mapped persistently if the driver has
+ * `GL_ARB_buffer_storage`, else they are mapped for each band. Without
+ * fences (before OpenGL 3.2) the textures are uploaded at once.
+ * Must be used from the thread that owns the GL context.
+ */
+class TextureUploader {
+public:
+    TextureUploader() = default;
+    // releases the buffers (the GL context has to be alive)
+    ~TextureUploader();
+
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader(TextureUploader&&) = delete;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+    TextureUploader& operator=(TextureUploader&&) = delete;
+
+    /**
+     * Allocates the texture and queues its pixels.
+     * @param `image` - with its mipmap levels, the pixels are not copied
+     *                  and have to outlive the upload
+     * @returns the texture (id 0 if it failed), it can be drawn once
+     *          `IsUploading` is false
+     */
+    Texture2D Upload(const Image& image);
+
+    // drops the bands that are not uploaded yet (before unloading the texture)
+    void Cancel(const unsigned int textureId);
+
+    /**
+     * Copies the next bands to the buffers that are free.
+     * This function should be called once every frame
+     * @param `completed` - set to the textures that can be drawn now
+     */
+    void Update(std::vector<unsigned int>& completed);
+
+    [[nodiscard]] bool IsUploading(const unsigned int textureId) const;
+    [[nodiscard]] inline bool Empty() const { return _uploads.empty(); }
+
+    // drops the uploads and releases the buffers
+    void Clear();
+
+private:
+    struct PendingUpload {
+        unsigned int textureId;
+        Image image; // not owned
+        int level; // next band
+        int row;
+        size_t levelOffset; // in the pixels of the image
+        void* fence; // of the last band, once all of them are queued
+    };
+
+    struct PixelBuffer {
+        unsigned int id;
+        unsigned char* mapped; // persistently, nullptr if mapped for each band
+        void* fence; // the GPU is still reading the last band
+    };
+
+    // creates the buffers, false if they are not supported
+    bool Init();
+
+    /**
+     * Copies the next bands of `upload` (as many rows as fit) to `buffer`
+     * and queues their upload to the texture
+     * @returns false if the buffer could not be written
+     */
+    bool FillBuffer(PendingUpload& upload, PixelBuffer& buffer);
+
+private:
+    constexpr static size_t _bufferSize = 16 * 1024 * 1024;
+    constexpr static size_t _bufferCount = 2;
+
+    PixelBuffer _buffers[_bufferCount]{};
+    size_t _nextBuffer = 0;
+    bool _initialized = false;
+    bool _supported = false; // fences and pixel buffers are available
+    bool _persistent = false;
+    std::deque<PendingUpload> _uploads; // in order
+};
@@ -0,0 +1,284 @@
+#include "tiledTexture.hpp"
+
+// the OpenGL loader of raylib, like `textureUploader.cpp`
+#include "raylib/src/external/glad.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+
+TiledTexture::~TiledTexture() {
+    Clear();
+}
+
+void TiledTexture::SetImage(const Image& image, const TextureFiltering filtering) {
+    Clear();
+    _image = image;
+    _filtering = filtering;
+
+    // same layout as the mipmaps uploaded by raylib
+    size_t offset = 0;
+    int width = image.width;
+    int height = image.height;
+    for (int i = 0; i < std::max(image.mipmaps, 1); ++i) {
+        _levels.push_back(Level{ .offset = offset, .width = width, .height = height });
+        offset += static_cast<size_t>(GetPixelDataSize(width, height, image.format));
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    // the first level that fits in a texture (or the last one there is)
+    const int baseSize = std::min(_baseSize, GetMaxTextureSize());
+    _baseLevel = _levels.size() - 1;
+    for (size_t i = 0; i < _levels.size(); ++i) {
+        if (_levels[i].width <= baseSize && _levels[i].height <= baseSize) {
+            _baseLevel = i;
+            break;
+        }
+    }
+
+    _base = LoadRegion(_baseLevel, 0, 0, _levels[_baseLevel].width, _levels[_baseLevel].height);
+}
+
+void TiledTexture::SetFiltering(const TextureFiltering filtering) {
+    _filtering = filtering;
+    if (_base.id != 0) {
+        ApplyFiltering(_base);
+    }
+    for (const auto& [key, tile] : _tiles) {
+        ApplyFiltering(tile.texture);
+    }
+}
+
+void TiledTexture::Clear() {
+    UnloadRegion(_base);
+    for (auto& [key, tile] : _tiles) {
+        UnloadRegion(tile.texture);
+    }
+
+    _tiles.clear();
+    _lru.clear();
+    _levels.clear();
+    _image = Image{};
+    _baseLevel = 0;
+    _loading = false;
+}
+
+void TiledTexture::Draw(const Camera2D& camera,
+    const Rectangle& dst,
+    const Vector2& origin,
+    const float rotation) {
+    if (Empty() || dst.width <= 0.0f || dst.height <= 0.0f)
+        return;
+
+    ++_frame;
+    _loading = false;
+
+    if (_base.id != 0) {
+        DrawTexturePro(_base,
+            Rectangle{ 0.0f, 0.0f, static_cast<float>(_base.width), static_cast<float>(_base.height) },
+            dst, origin, rotation, WHITE);
+    }
+
+    // screen pixels per pixel of the image, the level is the first one that
+    // is not smaller than the screen
+    const float scale = camera.zoom * dst.width / static_cast<float>(_image.width);
+    size_t level = 0;
+    if (scale < 1.0f) {
+        level = static_cast<size_t>(std::floor(std::log2(1.0f / scale)));
+    }
+    if (level >= _baseLevel)
+        return;
+
+    // visible part of the image, the corners of the screen are transformed
+    // into the space of `dst` (before the rotation)
+    const float radians = -rotation * DEG2RAD;
+    const float cosR = std::cos(radians);
+    const float sinR = std::sin(radians);
+    float minX = dst.width;
+    float minY = dst.height;
+    float maxX = 0.0f;
+    float maxY = 0.0f;
+    const float screenWidth = static_cast<float>(GetScreenWidth());
+    const float screenHeight = static_cast<float>(GetScreenHeight());
+    for (const Vector2 corner : { Vector2{ 0.0f, 0.0f }, Vector2{ screenWidth, 0.0f },
+            Vector2{ 0.0f, screenHeight }, Vector2{ screenWidth, screenHeight } }) {
+        const Vector2 world = GetScreenToWorld2D(corner, camera);
+        const float x = world.x - dst.x;
+        const float y = world.y - dst.y;
+        const float localX = x * cosR - y * sinR + origin.x;
+        const float localY = x * sinR + y * cosR + origin.y;
+        minX = std::min(minX, localX);
+        minY = std::min(minY, localY);
+        maxX = std::max(maxX, localX);
+        maxY = std::max(maxY, localY);
+    }
+
+    // the image is not on screen
+    if (maxX < 0.0f || maxY < 0.0f || minX > dst.width || minY > dst.height)
+        return;
+
+    const Level& lvl = _levels[level];
+    const float toLevelX = static_cast<float>(lvl.width) / dst.width;
+    const float toLevelY = static_cast<float>(lvl.height) / dst.height;
+    const int lastTileX = (lvl.width - 1) / _tileSize;
+    const int lastTileY = (lvl.height - 1) / _tileSize;
+    const int firstX = std::clamp(static_cast<int>(minX * toLevelX) / _tileSize, 0, lastTileX);
+    const int firstY = std::clamp(static_cast<int>(minY * toLevelY) / _tileSize, 0, lastTileY);
+    const int lastX = std::clamp(static_cast<int>(maxX * toLevelX) / _tileSize, 0, lastTileX);
+    const int lastY = std::clamp(static_cast<int>(maxY * toLevelY) / _tileSize, 0, lastTileY);
+
+    int uploadsLeft = _maxUploadsPerFrame;
+    for (int tileY = firstY; tileY <= lastY; ++tileY) {
+        for (int tileX = firstX; tileX <= lastX; ++tileX) {
+            const Tile* tile = GetTile(level, tileX, tileY, uploadsLeft);
+            if (tile == nullptr) {
+                _loading = true;
+                continue;
+            }
+
+            const int x = tileX * _tileSize;
+            const int y = tileY * _tileSize;
+            const float width = static_cast<float>(std::min(_tileSize, lvl.width - x));
+            const float height = static_cast<float>(std::min(_tileSize, lvl.height - y));
+            const Rectangle src{
+                static_cast<float>(x - tile->x),
+                static_cast<float>(y - tile->y),
+                width,
+                height,
+            };
+
+            // rotated around the same point as the whole image
+            const float tileLeft = static_cast<float>(x) / toLevelX;
+            const float tileTop = static_cast<float>(y) / toLevelY;
+            DrawTexturePro(tile->texture,
+                src,
+                Rectangle{ dst.x, dst.y, width / toLevelX, height / toLevelY },
+                Vector2{ origin.x - tileLeft, origin.y - tileTop },
+                rotation,
+                WHITE);
+        }
+    }
+
+    Evict();
+}
+
+int TiledTexture::GetMaxTextureSize() {
+    static const int maxSize = []() {
+        GLint size = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &size);
+        // the minimum of OpenGL 3.3
+        return size > 0 ? static_cast<int>(size) : 1024;
+    }();
+
+    return maxSize;
+}
+
+uint64_t TiledTexture::MakeKey(const size_t level, const int x, const int y) {
+    return (static_cast<uint64_t>(level) << 48)
+        | (static_cast<uint64_t>(x) << 24)
+        | static_cast<uint64_t>(y);
+}
+
+Texture2D TiledTexture::LoadRegion(const size_t level,
+    const int x,
+    const int y,
+    const int width,
+    const int height) {
+    const Level& lvl = _levels[level];
+    const size_t pixelSize = static_cast<size_t>(GetPixelDataSize(1, 1, _image.format));
+    const size_t srcStride = static_cast<size_t>(lvl.width) * pixelSize;
+    const size_t dstStride = static_cast<size_t>(width) * pixelSize;
+
+    const unsigned char* src = static_cast<const unsigned char*>(_image.data)
+        + lvl.offset + static_cast<size_t>(y) * srcStride + static_cast<size_t>(x) * pixelSize;
+    _uploadBuffer.resize(dstStride * static_cast<size_t>(height));
+    for (int row = 0; row < height; ++row) {
+        std::memcpy(_uploadBuffer.data() + static_cast<size_t>(row) * dstStride,
+            src + static_cast<size_t>(row) * srcStride,
+            dstStride);
+    }
+
+    const Image region{
+        .data = _uploadBuffer.data(),
+        .width = width,
+        .height = height,
+        .mipmaps = 1,
+        .format = _image.format,
+    };
+    const Texture2D texture = LoadTextureFromImage(region);
+    if (texture.id != 0) {
+        ApplyFiltering(texture);
+        _textureBytes += _uploadBuffer.size();
+    }
+
+    return texture;
+}
+
+void TiledTexture::UnloadRegion(Texture2D& texture) {
+    if (texture.id == 0)
+        return;
+
+    _textureBytes -= static_cast<uint64_t>(GetPixelDataSize(texture.width, texture.height, texture.format));
+    UnloadTexture(texture);
+    texture = Texture2D{};
+}
+
+void TiledTexture::ApplyFiltering(const Texture2D& texture) const {
+    SetTextureWrap(texture, TEXTURE_WRAP_CLAMP);
+    SetTextureFilter(texture, _filtering == TextureFiltering::POINT
+        ? TEXTURE_FILTER_POINT
+        : TEXTURE_FILTER_BILINEAR);
+}
+
+const TiledTexture::Tile* TiledTexture::GetTile(const size_t level,
+    const int tileX,
+    const int tileY,
+    int& uploadsLeft) {
+    const uint64_t key = MakeKey(level, tileX, tileY);
+    auto it = _tiles.find(key);
+    if (it != _tiles.end()) {
+        Tile& tile = it->second;
+        tile.lastFrame = _frame;
+        _lru.splice(_lru.begin(), _lru, tile.lru);
+        return &tile;
+    }
+
+    if (uploadsLeft <= 0)
+        return nullptr;
+    --uploadsLeft;
+
+    const Level& lvl = _levels[level];
+    const int x = std::max(tileX * _tileSize - _tileBorder, 0);
+    const int y = std::max(tileY * _tileSize - _tileBorder, 0);
+    const int right = std::min((tileX + 1) * _tileSize + _tileBorder, lvl.width);
+    const int bottom = std::min((tileY + 1) * _tileSize + _tileBorder, lvl.height);
+    const Texture2D texture = LoadRegion(level, x, y, right - x, bottom - y);
+    if (texture.id == 0)
+        return nullptr;
+
+    _lru.push_front(key);
+    it = _tiles.emplace(key, Tile{
+        .texture = texture,
+        .x = x,
+        .y = y,
+        .lastFrame = _frame,
+        .lru = _lru.begin(),
+    }).first;
+
+    return &it->second;
+}
+
+void TiledTexture::Evict() {
+    while (_tiles.size() > _maxTiles) {
+        const auto it = _tiles.find(_lru.back());
+        // everything left is on screen
+        if (it->second.lastFrame == _frame)
+            break;
+
+        UnloadRegion(it->second.texture);
+        _tiles.erase(it);
+        _lru.pop_back();
+    }
+}
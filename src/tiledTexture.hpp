@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include "raylib.h"
+#include "types.hpp"
+
+
+/**
+ * Draws an image that is too large for a single texture (eg: panoramas and
+ * medium format files) as 512x512 tiles of its mipmap levels. Only the tiles
+ * that are on screen are uploaded, from the level closest to the screen
+ * resolution, and the least recently drawn ones are unloaded once there are
+ * more than `_maxTiles`. A low resolution level is drawn below the tiles, so
+ * that there are no holes while they are being uploaded.
+ *
+ * The pixels are not owned, they have to outlive the tiles (the image is
+ * pinned in `TextureCache` while it is on screen).
+ * Must be used from the thread that owns the GL context.
+ */
+class TiledTexture {
+public:
+    TiledTexture() = default;
+    ~TiledTexture();
+
+    TiledTexture(const TiledTexture&) = delete;
+    TiledTexture(TiledTexture&&) = delete;
+    TiledTexture& operator=(const TiledTexture&) = delete;
+    TiledTexture& operator=(TiledTexture&&) = delete;
+
+    /**
+     * @param `image` - decoded image with its mipmap levels
+     * @param `filtering` - of the tiles (there is no blending between levels)
+     */
+    void SetImage(const Image& image, const TextureFiltering filtering);
+    void SetFiltering(const TextureFiltering filtering);
+
+    // unloads the tiles and forgets the image
+    void Clear();
+
+    /**
+     * Draws the tiles that are visible with `camera`, the parameters are the
+     * same as `DrawTexturePro` for the whole image. Uploads at most
+     * `_maxUploadsPerFrame` tiles.
+     */
+    void Draw(const Camera2D& camera,
+        const Rectangle& dst,
+        const Vector2& origin,
+        const float rotation);
+
+    [[nodiscard]] inline bool Empty() const { return _image.data == nullptr; }
+    // tiles were missing in the last `Draw`
+    [[nodiscard]] inline bool IsLoading() const { return _loading; }
+    [[nodiscard]] inline uint64_t GetTextureBytes() const { return _textureBytes; }
+
+    // GL_MAX_TEXTURE_SIZE, queried once
+    static int GetMaxTextureSize();
+
+private:
+    struct Level {
+        size_t offset; // in the pixels of the image
+        int width;
+        int height;
+    };
+
+    struct Tile {
+        Texture2D texture;
+        int x; // of the texture in the level (with the border)
+        int y;
+        uint64_t lastFrame; // last drawn in
+        std::list<uint64_t>::iterator lru;
+    };
+
+    static uint64_t MakeKey(const size_t level, const int x, const int y);
+
+    // uploads a region of a level (the id is 0 if it failed)
+    Texture2D LoadRegion(const size_t level, const int x, const int y, const int width, const int height);
+    void UnloadRegion(Texture2D& texture);
+    void ApplyFiltering(const Texture2D& texture) const;
+
+    /**
+     * @returns the tile (uploading it if there are uploads left in this
+     *          frame), nullptr if it is not uploaded yet
+     */
+    const Tile* GetTile(const size_t level, const int tileX, const int tileY, int& uploadsLeft);
+
+    // unloads the least recently drawn tiles that were not drawn in this frame
+    void Evict();
+
+private:
+    constexpr static int _tileSize = 512;
+    // texels of the neighbors around each tile, so that the bilinear
+    // filter does not show seams
+    constexpr static int _tileBorder = 1;
+    constexpr static int _baseSize = 2048; // max size of the level below the tiles
+    constexpr static size_t _maxTiles = 96; // about a 4K screen of 512x512 tiles
+    constexpr static int _maxUploadsPerFrame = 8;
+
+    Image _image{};
+    std::vector<Level> _levels;
+    TextureFiltering _filtering = TextureFiltering::TRILINEAR;
+
+    Texture2D _base{}; // whole level, drawn below the tiles
+    size_t _baseLevel = 0;
+
+    std::unordered_map<uint64_t, Tile> _tiles;
+    std::list<uint64_t> _lru; // most recently drawn first
+    std::vector<unsigned char> _uploadBuffer;
+    uint64_t _textureBytes = 0;
+    uint64_t _frame = 0;
+    bool _loading = false;
+};
@@ -0,0 +1,349 @@
+#include "trashQueue.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include "logger.hpp"
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/stat.h>
+#endif
+
+
+namespace {
+
+#if !defined(_WIN32)
+
+// directory of the file (ending with a '/'), "" if none
+std::string GetDirectory(const std::string& filepath) {
+    const size_t end = filepath.find_last_of('/');
+    return end == std::string::npos ? "" : filepath.substr(0, end + 1);
+}
+
+// makes the renames and unlinks in the directory durable
+void SyncDirectory(const std::string& directory) {
+    const int fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    fsync(fd);
+    close(fd);
+}
+
+/**
+ * Copies the file and syncs the copy to disk
+ * @returns errno of the failed call, 0 if the file was copied
+ */
+int CopyFileSynced(const std::string& source, const std::string& destination) {
+    const int in = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+        return errno;
+
+    struct stat sourceStat{};
+    if (fstat(in, &sourceStat) != 0) {
+        const int err = errno;
+        close(in);
+        return err;
+    }
+
+    const int out = open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        const int err = errno;
+        close(in);
+        return err;
+    }
+
+    constexpr size_t bufferSize = 1 << 20;
+    std::vector<char> buffer(bufferSize);
+    int err = 0;
+    while (err == 0) {
+        const ssize_t bytesRead = read(in, buffer.data(), bufferSize);
+        if (bytesRead == 0)
+            break;
+        if (bytesRead < 0) {
+            err = errno == EINTR ? 0 : errno;
+            continue;
+        }
+
+        for (ssize_t written = 0; written < bytesRead && err == 0;) {
+            const ssize_t n = write(out, buffer.data() + written, static_cast<size_t>(bytesRead - written));
+            if (n < 0) {
+                err = errno == EINTR ? 0 : errno;
+            } else {
+                written += n;
+            }
+        }
+    }
+
+    // keep the modification time, so that the cached textures of the image
+    // are still valid when it is restored
+    const timespec times[2] = { sourceStat.st_atim, sourceStat.st_mtim };
+    if (err == 0 && futimens(out, times) != 0) {
+        err = errno;
+    }
+    if (err == 0 && fsync(out) != 0) {
+        err = errno;
+    }
+    if (close(out) != 0 && err == 0) {
+        err = errno;
+    }
+    close(in);
+
+    if (err != 0) {
+        unlink(destination.c_str());
+    }
+    return err;
+}
+
+#endif
+
+} // namespace
+
+
+TrashQueue::~TrashQueue() {
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        _stop = true;
+    }
+    _wake.notify_one();
+
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+void TrashQueue::Push(const std::string& source,
+    const std::string& trashDir,
+    const int64_t listIndex,
+    const bool optional) {
+    Enqueue(Move{
+        .source = source,
+        .trashDir = trashDir,
+        .listIndex = listIndex,
+        .optional = optional,
+        .restore = false,
+    });
+}
+
+void TrashQueue::PushRestore(const std::string& source,
+    const std::string& trashDir,
+    const int64_t listIndex,
+    const bool optional) {
+    Enqueue(Move{
+        .source = source,
+        .trashDir = trashDir,
+        .listIndex = listIndex,
+        .optional = optional,
+        .restore = true,
+    });
+}
+
+bool TrashQueue::PollRestored(std::vector<std::string>& paths) {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    if (_restored.empty())
+        return false;
+
+    paths.insert(paths.end(),
+        std::make_move_iterator(_restored.begin()),
+        std::make_move_iterator(_restored.end()));
+    _restored.clear();
+    return true;
+}
+
+void TrashQueue::Enqueue(Move move) {
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        _queue.push_back(std::move(move));
+        ++_pending;
+
+        if (!_thread.joinable()) {
+            _thread = std::thread(&TrashQueue::MoveLoop, this);
+        }
+    }
+    _wake.notify_one();
+}
+
+TrashStatus TrashQueue::GetStatus() const {
+    std::lock_guard<std::mutex> lock{ _mutex };
+    return TrashStatus{
+        .pending = _pending,
+        .failed = _failed,
+        .lastError = _lastError,
+    };
+}
+
+void TrashQueue::MoveLoop() {
+    std::unique_lock<std::mutex> lock{ _mutex };
+    while (true) {
+        if (_queue.empty()) {
+            // the queue has drained, sync what has been moved so far
+            if (_unsyncedMoves > 0) {
+                lock.unlock();
+                SyncDirectories();
+                lock.lock();
+                continue;
+            }
+            if (_stop) {
+                if (_journal != nullptr) {
+                    std::fclose(_journal);
+                    _journal = nullptr;
+                }
+                break;
+            }
+
+            _wake.wait(lock, [this]() { return _stop || !_queue.empty(); });
+            continue;
+        }
+
+        const Move move = std::move(_queue.front());
+        _queue.pop_front();
+        lock.unlock();
+
+        const size_t nameStart = move.source.find_last_of("\\/");
+        const std::string trashPath = move.trashDir
+            + (nameStart == std::string::npos ? move.source : move.source.substr(nameStart + 1));
+        const std::string& from = move.restore ? trashPath : move.source;
+        const std::string& to = move.restore ? move.source : trashPath;
+
+        if (!move.restore) {
+            std::error_code err;
+            std::filesystem::create_directories(move.trashDir, err);
+        }
+
+        std::string error;
+        const MoveResult result = MoveFile(from, to, move.optional, error);
+        if (result == MoveResult::MOVED) {
+            AppendJournal(move, from, to);
+        } else if (result == MoveResult::FAILED) {
+            logger::error("Failed to move \"%s\" to \"%s\": %s",
+                from.c_str(), to.c_str(), error.c_str());
+        }
+
+        if (++_unsyncedMoves >= _syncBatchSize) {
+            SyncDirectories();
+        }
+
+        lock.lock();
+        --_pending;
+        if (result == MoveResult::FAILED) {
+            ++_failed;
+            _lastError = from + ": " + error;
+        } else if (result == MoveResult::MOVED && move.restore) {
+            _restored.push_back(move.source);
+        }
+    }
+}
+
+TrashQueue::MoveResult TrashQueue::MoveFile(const std::string& from,
+    const std::string& to,
+    const bool optional,
+    std::string& error) {
+#if defined(_WIN32)
+    std::error_code err;
+    std::filesystem::rename(from, to, err);
+    if (!err)
+        return MoveResult::MOVED;
+    if (optional && !std::filesystem::exists(from))
+        return MoveResult::MISSING;
+
+    // eg: the trash directory is on another drive
+    std::filesystem::copy_file(from, to,
+        std::filesystem::copy_options::overwrite_existing, err);
+    if (!err) {
+        std::filesystem::remove(from, err);
+    }
+    if (err) {
+        error = err.message();
+        return MoveResult::FAILED;
+    }
+
+    return MoveResult::MOVED;
+#else
+    const auto markDirty = [this](const std::string& dir) {
+        if (std::find(_dirtyDirs.begin(), _dirtyDirs.end(), dir) == _dirtyDirs.end()) {
+            _dirtyDirs.push_back(dir);
+        }
+    };
+
+    if (rename(from.c_str(), to.c_str()) == 0) {
+        markDirty(GetDirectory(from));
+        markDirty(GetDirectory(to));
+        return MoveResult::MOVED;
+    }
+
+    if (errno == ENOENT && optional)
+        return MoveResult::MISSING;
+    if (errno != EXDEV) {
+        error = std::strerror(errno);
+        return MoveResult::FAILED;
+    }
+
+    // the trash directory is on another file system, the copy (and its
+    // directory entry) is synced before the file is unlinked so that a crash
+    // cannot lose both
+    const std::string partial = to + ".part";
+    int copyErr = CopyFileSynced(from, partial);
+    if (copyErr == 0 && rename(partial.c_str(), to.c_str()) != 0) {
+        copyErr = errno;
+        unlink(partial.c_str());
+    }
+    // (rename reports EXDEV before checking that the file exists)
+    if (copyErr == ENOENT && optional)
+        return MoveResult::MISSING;
+    if (copyErr != 0) {
+        error = std::strerror(copyErr);
+        return MoveResult::FAILED;
+    }
+    SyncDirectory(GetDirectory(to));
+
+    if (unlink(from.c_str()) != 0) {
+        error = std::string{ "copied, but could not remove the file: " } + std::strerror(errno);
+        return MoveResult::FAILED;
+    }
+    markDirty(GetDirectory(from));
+
+    return MoveResult::MOVED;
+#endif
+}
+
+void TrashQueue::AppendJournal(const Move& move, const std::string& from, const std::string& to) {
+    const std::string journalPath = move.trashDir + _journalName;
+    if (_journal == nullptr || journalPath != _journalPath) {
+        if (_journal != nullptr) {
+            std::fclose(_journal);
+        }
+
+        _journalPath = journalPath;
+        _journal = std::fopen(_journalPath.c_str(), "a");
+        if (_journal == nullptr) {
+            logger::error("Failed to open the trash journal: %s", _journalPath.c_str());
+            return;
+        }
+    }
+
+    std::fprintf(_journal, "%s\t%lld\t%s\t%s\n",
+        move.restore ? "restore" : "trash",
+        static_cast<long long>(move.listIndex),
+        from.c_str(), to.c_str());
+}
+
+void TrashQueue::SyncDirectories() {
+    if (_journal != nullptr) {
+        std::fflush(_journal);
+#if !defined(_WIN32)
+        fsync(fileno(_journal));
+#endif
+    }
+
+#if !defined(_WIN32)
+    for (const std::string& dir : _dirtyDirs) {
+        SyncDirectory(dir);
+    }
+#endif
+
+    _dirtyDirs.clear();
+    _unsyncedMoves = 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "types.hpp"
+
+
+/**
+ * Moves the deleted files to the trash directory on a background thread, in
+ * the order they were queued, so that deleting does not block rendering.
+ *
+ * A file is renamed if it can be, across file systems (eg: the trash
+ * directory is on another drive) it is copied, synced and then unlinked.
+ * The directories are synced once per batch of moves instead of after each
+ * file.
+ *
+ * Every move is appended to a journal in the trash directory (`.journal`,
+ * one line per file: operation, list index, from and to), and files can be
+ * moved back from the trash directory to undo a delete.
+ */
+class TrashQueue {
+public:
+    TrashQueue() = default;
+    // waits for the queued moves
+    ~TrashQueue();
+
+    TrashQueue(const TrashQueue&) = delete;
+    TrashQueue(TrashQueue&&) = delete;
+    TrashQueue& operator=(const TrashQueue&) = delete;
+    TrashQueue& operator=(TrashQueue&&) = delete;
+
+    /**
+     * Queues moving a file, does not block
+     * @param `source` - path of the file
+     * @param `trashDir` - directory to move it to (ending with a '/'),
+     *                     created if it does not exist
+     * @param `listIndex` - position of the image in the list (for the
+     *                      journal), -1 if it is not in the list
+     * @param `optional` - the file might not exist (eg: the raw image of a
+     *                     jpg), it is not a failure if it does not
+     */
+    void Push(const std::string& source,
+        const std::string& trashDir,
+        const int64_t listIndex,
+        const bool optional = false);
+
+    /**
+     * Queues moving a file back from the trash directory, after the moves
+     * that were queued before it. Same parameters as `Push`.
+     */
+    void PushRestore(const std::string& source,
+        const std::string& trashDir,
+        const int64_t listIndex,
+        const bool optional = false);
+
+    /**
+     * Moves the paths of the files that have been restored since the last
+     * call to the end of `paths`. Does not block.
+     * @returns false if no files were restored
+     */
+    bool PollRestored(std::vector<std::string>& paths);
+
+    [[nodiscard]] TrashStatus GetStatus() const;
+
+private:
+    struct Move {
+        std::string source; // path of the file outside of the trash directory
+        std::string trashDir;
+        int64_t listIndex;
+        bool optional;
+        bool restore; // from the trash directory back to `source`
+    };
+
+    void Enqueue(Move move);
+
+    // runs on `_thread`
+    void MoveLoop();
+
+    enum class MoveResult {
+        MOVED,
+        MISSING, // the file is optional and does not exist
+        FAILED,
+    };
+
+    /**
+     * @param `error` - set if the move failed
+     */
+    MoveResult MoveFile(const std::string& from,
+        const std::string& to,
+        const bool optional,
+        std::string& error);
+
+    // appends the move to the journal of its trash directory
+    void AppendJournal(const Move& move, const std::string& from, const std::string& to);
+
+    // syncs the directories touched since the last call
+    void SyncDirectories();
+
+private:
+    // the directories are synced at least every this many moves
+    constexpr static size_t _syncBatchSize = 32;
+    constexpr static char _journalName[] = ".journal";
+
+    std::thread _thread;
+    mutable std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<Move> _queue; // not started yet
+    uint64_t _pending = 0; // queued or being moved
+    uint64_t _failed = 0;
+    std::string _lastError;
+    std::vector<std::string> _restored; // not polled yet
+    bool _stop = false;
+
+    // only used on `_thread`
+    std::vector<std::string> _dirtyDirs; // not synced yet
+    size_t _unsyncedMoves = 0;
+    FILE* _journal = nullptr; // synced with the directories
+    std::string _journalPath;
+};
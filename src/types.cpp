@@ -1,16 +1,19 @@
 #include "types.hpp"
 
 #include <filesystem>
-#include "raylib.h"
 
 
 Config::Config(const char* path,
     const char* rawExt,
     const uint64_t wWidth,
-    const uint64_t wHeight)
+    const uint64_t wHeight,
+    const uint64_t textureCache,
+    const uint64_t imageCache)
     : rawImageExt{ rawExt },
       windowWidth{ wWidth },
-      windowHeight{ wHeight } {
+      windowHeight{ wHeight },
+      textureCacheSize{ textureCache },
+      imageCacheSize{ imageCache } {
     InitImageDirs(path);
 }
 
@@ -30,20 +33,3 @@ void Config::InitImageDirs(const char* path) {
     rawImagePath = imagePath;
     trashDir = imagePath + "trash/";
 }
-
-
-ImageDetails::ImageDetails(const char* path)
-    : filepath{ path },
-      filename{ "" },
-      filenameNoExt{ "" },
-      extension{ "" } {
-    filename = GetFileName(path);
-    extension = GetFileExtension(filename.c_str());
-    for (const auto& ch : filename) {
-        if (ch == '.')
-            break;
-
-        filenameNoExt += ch;
-    }
-}
-
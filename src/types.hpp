@@ -4,15 +4,25 @@
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <vector>
 #include <optional>
 
 
+// how the textures are sampled when they are scaled
+enum class TextureFiltering {
+    POINT = 0, // nearest texel of the nearest mipmap level
+    BILINEAR, // of the nearest mipmap level
+    TRILINEAR, // bilinear, blended between the two nearest mipmap levels
+};
+
 class Config {
 public:
     explicit Config(const char* path = "",
         const char* rawExt = ".ARW", // default is sony's raw file extension
         const uint64_t wWidth = 1280,
-        const uint64_t wHeight = 960);
+        const uint64_t wHeight = 960,
+        const uint64_t textureCache = 512,
+        const uint64_t imageCache = 1024);
 
 public:
     std::string imagePath; // jpg/png directory path or file path
@@ -23,6 +33,11 @@ public:
     uint64_t windowWidth;
     uint64_t windowHeight;
 
+    uint64_t textureCacheSize; // VRAM budget of the image cache (in MB)
+    uint64_t imageCacheSize; // RAM budget of the image cache (in MB)
+
+    TextureFiltering textureFiltering = TextureFiltering::TRILINEAR;
+
 private:
     /**
      * Initializes the image directories (image path, raw image path, and trash
@@ -35,16 +50,36 @@ private:
 };
 
 
-struct ImageDetails {
-public:
-    explicit ImageDetails(const char* path);
+// whether an image has raw files, see `PairingIndex`
+enum class PairingState {
+    UNKNOWN = 0, // the directory has not been listed yet
+    PAIRED, // jpg/png with raw files (or raw file with a jpg/png)
+    NO_RAW, // jpg/png without raw files
+    ORPHAN_RAW, // raw file without a jpg/png
+};
 
-public:
+// copy of an image in `ImageList`, see `ImageList::GetDetails`
+struct ImageDetails {
     std::string filepath; // full path of the file
     std::string filename; // filename with extension
-    std::string filenameNoExt; // filename without extension
-    std::string extension; // lower-case
-    std::optional<tinyexif::EXIFInfo> exifInfo;
+    std::string extension;
+    std::optional<tinyexif::EXIFRecord> exif; // once the image has been loaded
+    PairingState pairing = PairingState::UNKNOWN;
+    std::vector<std::string> siblings; // filenames of the raw and sidecar files
+};
+
+// position of the current image in the list, for the image counter
+struct ImageCounter {
+    uint64_t index; // of the current image (0 if there are no images)
+    uint64_t count;
+    bool scanning; // more images are being listed
+};
+
+// moves of deleted files to the trash directory, see `TrashQueue`
+struct TrashStatus {
+    uint64_t pending; // queued or being moved
+    uint64_t failed;
+    std::string lastError; // file and reason of the last failed move
 };
 
 struct TextFields {
@@ -60,3 +95,8 @@ enum class ImageRotation {
     RIGHT_180 = 180,
     RIGHT_270 = 270
 };
+
+enum class SortOrder {
+    NAME = 0,
+    DATE_TAKEN // EXIF capture time from the metadata catalog
+};
@@ -9,6 +9,49 @@
 #include "backends/imgui_impl_opengl3.h"
 #include "misc/cpp/imgui_stdlib.h"
 
+#include "utils.hpp"
+
+
+namespace {
+
+// deleted images that are still being moved to the trash directory (or
+// could not be), the reason of the last failure is shown on hover
+void ShowTrashStatus(const TrashStatus& trash) {
+    if (trash.pending == 0 && trash.failed == 0)
+        return;
+
+    ImGui::Text("Trash        : %llu pending, %llu failed",
+        static_cast<unsigned long long>(trash.pending),
+        static_cast<unsigned long long>(trash.failed));
+    if (trash.failed > 0 && ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("%s", trash.lastError.c_str());
+    }
+}
+
+// raw and sidecar files of the image
+void ShowPairing(const ImageDetails& details) {
+    switch (details.pairing) {
+        case PairingState::UNKNOWN:
+            return;
+        case PairingState::NO_RAW:
+            ImGui::Text("Raw files    : none");
+            return;
+        case PairingState::ORPHAN_RAW:
+            ImGui::Text("Raw files    : orphan raw (no jpg/png)");
+            return;
+        case PairingState::PAIRED:
+            break;
+    }
+
+    std::string siblings;
+    for (const std::string& sibling : details.siblings) {
+        siblings += (siblings.empty() ? "" : ", ") + sibling;
+    }
+    ImGui::Text("Raw files    : %s", siblings.empty() ? "paired" : siblings.c_str());
+}
+
+} // namespace
+
 
 namespace ui {
 
@@ -47,48 +90,61 @@ void UnFocusAllWindows() {
     ImGui::SetWindowFocus(nullptr);
 }
 
-ImGuiWindow* CreateImageInfoWindow(const std::optional<ImageDetails>& imgInfo, bool show) {
+ImGuiWindow* CreateImageInfoWindow(const std::optional<ImageDetails>& imgInfo,
+    const ImageCounter& counter,
+    const TrashStatus& trash,
+    bool show) {
     if (!show)
         return nullptr;
 
     ImGui::Begin("Image Info", nullptr, ImGuiWindowFlags_NoFocusOnAppearing);
     ImGuiWindow* handle = ImGui::GetCurrentWindow();
-    ImGui::SetWindowSize(ImVec2{ 365.0f, 195.0f });
+    ImGui::SetWindowSize(ImVec2{ 365.0f, 255.0f });
 
     if (!imgInfo.has_value()) {
-        ImGui::Text("** No images found! **");
+        ImGui::Text(counter.scanning ? "** Looking for images... **" : "** No images found! **");
+        ShowTrashStatus(trash);
         ImGui::End();
         return nullptr;
     }
 
+    // the count goes up while the directory is being listed
+    ImGui::Text("Image        : %llu / %llu%s",
+        static_cast<unsigned long long>(counter.index + 1),
+        static_cast<unsigned long long>(counter.count),
+        counter.scanning ? " (listing...)" : "");
     ImGui::Text("File name    : %s", imgInfo.value().filename.c_str());
+    ShowPairing(imgInfo.value());
 
-    if (imgInfo.value().exifInfo.has_value()) {
-        const tinyexif::EXIFInfo exifInfo = imgInfo.value().exifInfo.value();
+    if (imgInfo.value().exif.has_value()) {
+        const tinyexif::EXIFRecord& exif = imgInfo.value().exif.value();
 
-        ImGui::Text("Camera       : %s %s", exifInfo.Make.c_str(), exifInfo.Model.c_str());
-        ImGui::Text("Date-time    : %s", exifInfo.DateTime.c_str());
+        ImGui::Text("Camera       : %s %s", exif.str(exif.Make).c_str(), exif.str(exif.Model).c_str());
+        ImGui::Text("Date-time    : %s", exif.str(exif.DateTime).c_str());
 
-        if (exifInfo.ExposureTime < 1.0) {
+        if (exif.ExposureTime < 1.0) {
             ImGui::Text("Shutter speed: 1/%ds",
-                static_cast<int>(1.0f / exifInfo.ExposureTime));
+                static_cast<int>(1.0f / exif.ExposureTime));
         } else {
-            ImGui::Text("Shutter speed: %.2fs", exifInfo.ExposureTime);
+            ImGui::Text("Shutter speed: %.2fs", exif.ExposureTime);
         }
 
-        ImGui::Text("Aperture     : f/%.1f", exifInfo.FNumber);
-        ImGui::Text("ISO          : %hu", exifInfo.ISOSpeedRatings);
-        ImGui::Text("Focal length : %dmm", static_cast<int>(exifInfo.FocalLength));
-        ImGui::Text("Orientation  : %hu", exifInfo.Orientation);
+        ImGui::Text("Aperture     : f/%.1f", exif.FNumber);
+        ImGui::Text("ISO          : %hu", exif.ISOSpeedRatings);
+        ImGui::Text("Focal length : %dmm", static_cast<int>(exif.FocalLength));
+        ImGui::Text("Orientation  : %hu", exif.Orientation);
     } else if (imgInfo.value().extension != ".JPG"
             && imgInfo.value().extension != ".jpg"
             && imgInfo.value().extension != ".JPEG"
-            && imgInfo.value().extension != ".jpeg") {
+            && imgInfo.value().extension != ".jpeg"
+            && !utils::IsRawImage(imgInfo.value().filepath.c_str())) {
         ImGui::Text("** Cannot parse EXIF data for non-JPEG images! **");
     } else {
         ImGui::Text("** EXIF data not found! **");
     }
 
+    ShowTrashStatus(trash);
+
     ImGui::End();
     return handle;
 }
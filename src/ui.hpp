@@ -13,8 +13,18 @@ void EndUI();
 
 void UnFocusAllWindows();
 
+/**
+  * @param `imgInfo` - details of the current image
+  * @param `counter` - position of the current image in the list
+  * @param `trash` - moves of the deleted images that are pending or failed
+  * @param `show` - to show/hide the window
+  *
+  * @returns ImGuiWindow handle
+  */
 ImGuiWindow* CreateImageInfoWindow(
     const std::optional<ImageDetails>& imgInfo,
+    const ImageCounter& counter,
+    const TrashStatus& trash,
     bool show
 );
 
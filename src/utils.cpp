@@ -4,8 +4,14 @@
 #include <filesystem>
 #include <string>
 #include <cstring>
+#include <cstdlib>
 #include "raylib.h"
 #include "logger.hpp"
+#include "directoryScanner.hpp"
+
+#if !defined(_WIN32)
+    #include <sys/resource.h>
+#endif
 
 namespace utils {
 
@@ -22,6 +28,10 @@ void ParseArgs(int argc, char* argv[], Config& config) {
             std::cout << "-t <path>     Path to trash directory\n"\
                          "              (the deleted files will be moved here)\n";
             std::cout << "-e <value>    Raw file extension (eg: \".ARW\")\n";
+            std::cout << "-v <value>    Max VRAM used by cached textures in MB (default: 512)\n";
+            std::cout << "-m <value>    Max RAM used by cached images in MB (default: 1024)\n";
+            std::cout << "-f <value>    Texture filtering: \"point\", \"bilinear\" or \"trilinear\"\n"\
+                         "              (default: \"trilinear\")\n";
             std::exit(0);
         } else if (i + 1 < argc && strcmp(argv[i + 1], "") != 0) {
             // we need values following these options
@@ -41,6 +51,28 @@ void ParseArgs(int argc, char* argv[], Config& config) {
                 // raw image extension
                 config.rawImageExt = argv[++i];
                 continue;
+            } else if (strcmp(argv[i], "-v") == 0) {
+                // texture cache size (MB)
+                config.textureCacheSize = std::strtoull(argv[++i], nullptr, 10);
+                continue;
+            } else if (strcmp(argv[i], "-m") == 0) {
+                // image cache size (MB)
+                config.imageCacheSize = std::strtoull(argv[++i], nullptr, 10);
+                continue;
+            } else if (strcmp(argv[i], "-f") == 0) {
+                // texture filtering
+                ++i;
+                if (strcmp(argv[i], "point") == 0) {
+                    config.textureFiltering = TextureFiltering::POINT;
+                } else if (strcmp(argv[i], "bilinear") == 0) {
+                    config.textureFiltering = TextureFiltering::BILINEAR;
+                } else if (strcmp(argv[i], "trilinear") == 0) {
+                    config.textureFiltering = TextureFiltering::TRILINEAR;
+                } else {
+                    std::cerr << "Invalid texture filtering: " << argv[i] << '\n';
+                    std::exit(-1);
+                }
+                continue;
             }
         } else {
             std::cerr << "Invalid arguments provided\n";
@@ -51,26 +83,17 @@ void ParseArgs(int argc, char* argv[], Config& config) {
 }
 
 bool IsValidImage(const char* filePath) {
-    if (!std::filesystem::exists(filePath)) {
-        return false;
-    } else if (std::filesystem::is_directory(filePath)) {
+    // the extension first, it does not touch the file system
+    if (!HasImageExtension(filePath)) {
         return false;
     }
 
-    const char* ext = GetFileExtension(filePath);
-    if (!ext) {
-        return false;
-    } else if (strcmp(ext, ".png") == 0  ||
-        strcmp(ext, ".PNG") == 0  ||
-        strcmp(ext, ".jpg") == 0  ||
-        strcmp(ext, ".JPG") == 0  ||
-        strcmp(ext, ".jpeg") == 0 ||
-        strcmp(ext, ".JPEG") == 0
-    ) {
-        return true;
-    }
+    std::error_code err;
+    return std::filesystem::is_regular_file(filePath, err);
+}
 
-    return false;
+bool IsRawImage(const char* filePath) {
+    return HasRawExtension(filePath);
 }
 
 void PrintEXIFData(const tinyexif::EXIFInfo& info) {
@@ -90,4 +113,19 @@ void PrintEXIFData(const tinyexif::EXIFInfo& info) {
     logger::info("    Orientation  : %hu", info.Orientation);
 }
 
+double GetProcessCpuTime() {
+#if defined(_WIN32)
+    return -1.0;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1.0;
+
+    const auto toSeconds = [](const timeval& time) {
+        return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) * 1e-6;
+    };
+    return toSeconds(usage.ru_utime) + toSeconds(usage.ru_stime);
+#endif
+}
+
 }
@@ -9,5 +9,11 @@ void ParseArgs(int argc, char* argv[], Config& config);
 // check if the file path is a valid image
 bool IsValidImage(const char* filePath);
 
+// check if the file is a TIFF based raw image (eg: ".ARW", ".NEF", ".CR2")
+bool IsRawImage(const char* filePath);
+
 void PrintEXIFData(const tinyexif::EXIFInfo& data);
+
+// CPU time used by the process (all threads) in seconds, -1 if not supported
+double GetProcessCpuTime();
 }